@@ -0,0 +1,220 @@
+// - benchmark the row kernels used during elimination (combine two rows,
+//   normalize by the gcd and count column signs) on random rows
+// - compare the previous implementation (valarray expressions and
+//   Euclid's gcd) with the scalar and AVX2 kernels, with the AVX2
+//   kernels writing into reused buffers, and with the fixed width kernel
+//   (at most 64 columns)
+// - print the timings to STDOUT
+//
+// Usage: bench-kernels [NUM_COLS] [--rows=N] [--reps=N]
+
+#include <cstdlib>      // atol
+#include <iomanip>      // setw
+#include <iostream>
+#include <memory>       // align
+#include <random>
+#include <vector>
+
+#include <boost/timer/timer.hpp>
+
+#include "fm.h"
+#include "kernels.h"
+
+#include "util.h"
+
+using namespace std;
+
+
+typedef vector<fm::ValArray> Rows;
+
+
+Rows random_rows(size_t num_rows, size_t num_cols)
+{
+    std::default_random_engine random_engine(0);
+    std::uniform_int_distribution<int> coef(-3, 3);
+    Rows rows;
+    for (size_t i = 0; i < num_rows; ++i) {
+        fm::ValArray v(num_cols);
+        for (auto& x : v) {
+            x = coef(random_engine);
+        }
+        v[0] = i % 2 ? 1 : -1;      // pivot column
+        rows.push_back(v);
+    }
+    return rows;
+}
+
+
+// The implementation of Vector::eliminate before the kernels were added.
+fm::ValArray reference_eliminate(const fm::ValArray& p, const fm::ValArray& n)
+{
+    fm::Value a = p[0], b = n[0];
+    fm::Value s = -sign(a*b);
+    a = abs(a);
+    b = abs(b);
+    fm::Value div = gcd(a, b);
+    fm::ValArray r = la::scaled_addition<fm::Value>(p, b / div,
+                                                   n, s * (a / div));
+    fm::Value g = 0;
+    for (fm::Value x : r) {
+        g = gcd<fm::Value>(g, abs(x));
+        if (g == 1) {
+            break;
+        }
+    }
+    if (g > 1) {
+        r /= g;
+    }
+    fm::ValArray d(r.size() - 1);
+    for (size_t j = 1; j < r.size(); ++j) {
+        d[j-1] = r[j];
+    }
+    return d;
+}
+
+
+// Rows padded to the fixed width, aligned for the fixed width kernel.
+struct FixedRows
+{
+    size_t width;
+    vector<fm::Value> buf;
+    fm::Value* base;
+
+    FixedRows(const Rows& rows, size_t width)
+        : width(width)
+        , buf(rows.size() * width + fm::kernel::fixed_align)
+    {
+        void* p = buf.data();
+        size_t space = buf.size() * sizeof(fm::Value);
+        base = (fm::Value*) std::align(fm::kernel::fixed_align,
+                                       rows.size() * width * sizeof(fm::Value),
+                                       p, space);
+        for (size_t i = 0; i < rows.size() && width; ++i) {
+            std::copy(std::begin(rows[i]), std::end(rows[i]), base + i*width);
+        }
+    }
+};
+
+
+// Combine all pairs of rows, return a checksum so that nothing is
+// optimized away.
+long combine_all(const Rows& rows, const fm::Matrix& vecs,
+                 const FixedRows& fixed, int variant)
+{
+    if (variant == 4) {
+        auto kernel = fm::kernel::fixed_eliminate(fixed.width);
+        FixedRows out(Rows(1), fixed.width);
+        long sum = 0;
+        for (size_t i = 0; i < rows.size(); i += 2) {
+            for (size_t j = 1; j < rows.size(); j += 2) {
+                kernel(fixed.base + i*fixed.width, fixed.base + j*fixed.width,
+                       0, out.base);
+                sum += out.base[1];
+            }
+        }
+        return sum;
+    }
+
+    fm::Vector out(rows[0].size() - 1);
+    vector<fm::Wide> scratch;
+    long sum = 0;
+    for (size_t i = 0; i < rows.size(); i += 2) {
+        for (size_t j = 1; j < rows.size(); j += 2) {
+            if (variant == 0) {
+                sum += reference_eliminate(rows[i], rows[j])[1];
+            }
+            else if (variant < 3) {
+                sum += vecs[i].eliminate(vecs[j], 0).get(1);
+            }
+            else {
+                vecs[i].eliminate(vecs[j], 0, out, scratch);
+                sum += out.get(1);
+            }
+        }
+    }
+    return sum;
+}
+
+
+long count_all(const Rows& rows, bool reference, size_t reps)
+{
+    size_t num_cols = rows[0].size();
+    long sum = 0;
+    for (size_t r = 0; r < reps; ++r) {
+        vector<int> pos(num_cols), neg(num_cols);
+        for (size_t j = 0; j < num_cols && reference; ++j) {
+            for (auto&& v : rows) {
+                pos[j] += v[j] > 0;
+                neg[j] += v[j] < 0;
+            }
+        }
+        for (size_t i = 0; i < rows.size() && !reference; ++i) {
+            fm::kernel::count_signs(std::begin(rows[i]), num_cols,
+                                    pos.data(), neg.data());
+        }
+        sum += pos[num_cols-1] - neg[num_cols-1];
+    }
+    return sum;
+}
+
+
+int main(int argc, char** argv, char** env)
+try
+{
+    util::Args args(argc, argv);
+    size_t num_cols = args.pos.empty() ? 256 : atol(args.pos[0].c_str());
+    size_t num_rows = atol(args.get("rows", "400").c_str());
+    size_t reps = atol(args.get("reps", "20").c_str());
+
+    Rows rows = random_rows(num_rows, num_cols);
+    fm::Matrix vecs;
+    for (auto&& v : rows) {
+        vecs.push_back(fm::Vector(v));
+    }
+    size_t width = fm::kernel::fixed_width(num_cols);
+    FixedRows fixed(rows, width);
+
+    cout << "Columns: " << num_cols << ", rows: " << num_rows
+        << ", AVX2: " << (fm::kernel::simd_available() ? "yes" : "no")
+        << "\n" << endl;
+    cout << setw(14) << "kernel" << setw(12) << "variant"
+        << setw(12) << "wall [s]" << setw(10) << "speedup" << endl;
+
+    const char* variants[] = {
+        "reference", "scalar", "avx2", "buffers", "fixed"};
+    for (int kind = 0; kind < 2; ++kind) {
+        double base = 0;
+        for (int variant = 0; variant < 3 + 2*(kind == 0); ++variant) {
+            if (variant == 2 && !fm::kernel::simd_available()) {
+                continue;
+            }
+            if (variant == 4 && !width) {
+                continue;
+            }
+            fm::kernel::set_simd(variant >= 2);
+            boost::timer::cpu_timer timer;
+            long sum = 0;
+            for (size_t r = 0; r < reps && kind == 0; ++r) {
+                sum += combine_all(rows, vecs, fixed, variant);
+            }
+            if (kind == 1) {
+                sum += count_all(rows, variant == 0, reps * 100);
+            }
+            double wall = timer.elapsed().wall / 1e9;
+            if (variant == 0) {
+                base = wall;
+            }
+            cout << setw(14) << (kind == 0 ? "eliminate" : "count_signs")
+                << setw(12) << variants[variant]
+                << setw(12) << setprecision(4) << wall
+                << setw(9) << setprecision(3) << base / wall << "x"
+                << "    (" << sum << ")" << endl;
+        }
+    }
+    fm::kernel::set_simd(true);
+    return 0;
+}
+catch (...)
+{
+    throw;
+}
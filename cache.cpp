@@ -0,0 +1,239 @@
+// Result cache, see cache.h.
+
+#include <cstdint>      // uint64_t
+#include <cstdio>       // rename, remove
+#include <cstdlib>      // getenv
+#include <fstream>
+#include <iomanip>      // setw, setfill
+#include <iostream>
+#include <sstream>
+#include <utility>      // move
+
+#include <sys/stat.h>   // stat, mkdir, chmod
+#include <unistd.h>     // getpid
+
+#include "cache.h"
+#include "sysfile.h"
+
+using std::string;
+
+
+namespace
+{
+
+    // splitmix64 finalizer
+    uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // 128 bit hash from two independent lanes (FNV-1a and a mixing chain).
+    // Not cryptographic, but collisions of the key text are detected on
+    // load anyway.
+    struct Hash
+    {
+        uint64_t a = 14695981039346656037ULL;
+        uint64_t b = 0x9e3779b97f4a7c15ULL;
+
+        void add(uint64_t x)
+        {
+            for (int i = 0; i < 8; ++i) {
+                a ^= (x >> 8*i) & 0xff;
+                a *= 1099511628211ULL;
+            }
+            b = mix(b ^ x);
+        }
+
+        void add(const string& s)
+        {
+            for (unsigned char c : s) {
+                add(uint64_t(c));
+            }
+            add(s.size());
+        }
+    };
+
+    string hex(uint64_t x)
+    {
+        std::ostringstream out;
+        out << std::hex << std::setfill('0') << std::setw(16) << x;
+        return out.str();
+    }
+
+    bool is_directory(const string& path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    // The modes are set explicitly rather than through the umask, so that
+    // the members of the group can add entries. The setgid bit makes new
+    // subdirectories and entries inherit the group of the directory.
+    void make_shared_dir(const string& path)
+    {
+        if (mkdir(path.c_str(), 0775) == 0) {
+            chmod(path.c_str(), 02775);
+        }
+    }
+
+}
+
+
+namespace fm
+{
+
+    // The rows are hashed exactly as given and in order, since the results
+    // of minimize and eliminate depend on both. Equalities are hashed as
+    // the pairs of inequalities they are written as in text form:
+    std::string digest(const System& s)
+    {
+        Hash h;
+        size_t num_rows = 0;
+        auto add_row = [&] (const ValArray& v) {
+            for (size_t j = 0; j < v.size(); ++j) {
+                h.add(uint64_t(Wide(v[j])));
+            }
+            ++num_rows;
+        };
+        for (auto&& v : s.ineqs) {
+            add_row(v.values);
+        }
+        for (auto&& v : s.eqs) {
+            add_row(v.values);
+            add_row(-v.values);
+        }
+        return util::sprint_all(s.num_cols, " cols, ", num_rows, " rows, ",
+                                hex(h.a), hex(h.b));
+    }
+
+    Cache::Cache(const util::Args& args)
+    {
+        if (args.has("no-cache")) {
+            return;
+        }
+        bool requested = true;
+        if (args.has("cache")) {
+            dir = args.get("cache");
+        }
+        else if (const char* env = std::getenv("CFME_CACHE")) {
+            dir = env;
+        }
+        else if (is_directory("results")) {
+            dir = "results";
+            requested = false;
+        }
+        if (!dir.empty() && git::has_uncommitted_changes) {
+            if (requested) {
+                std::cerr << "Cache disabled: the build has uncommitted "
+                    << "changes" << std::endl;
+            }
+            dir.clear();
+        }
+    }
+
+    bool Cache::enabled() const
+    {
+        return !dir.empty();
+    }
+
+    std::string Cache::operation(
+            const std::string& name, const util::Args& args,
+            std::initializer_list<const char*> options)
+    {
+        string op = name;
+        for (const char* opt : options) {
+            if (args.has(opt)) {
+                string value = args.get(opt);
+                op += string(" --") + opt;
+                op += value.empty() ? "" : "=" + value;
+            }
+        }
+        return op;
+    }
+
+    std::string Cache::key(const std::string& operation,
+                           const System* input) const
+    {
+        if (!enabled()) {
+            return "";
+        }
+        std::ostringstream key;
+        key << "# cache operation: " << operation << "\n"
+            << "# cache input:     " << (input ? digest(*input) : "none")
+            << "\n"
+            << "# cache commit:    " << git::commit_info() << "\n";
+        return key.str();
+    }
+
+    std::string Cache::path(const std::string& key) const
+    {
+        Hash h;
+        h.add(key);
+        string name = hex(h.a) + hex(h.b);
+        return dir + "/" + name.substr(0, 2) + "/" + name.substr(2) + ".sys";
+    }
+
+    bool Cache::load(const std::string& key, System& sys,
+                     std::string* provenance) const
+    {
+        if (!enabled()) {
+            return false;
+        }
+        string file = path(key);
+        if (!std::ifstream(file)) {
+            return false;
+        }
+        string header;
+        try {
+            System s = read_system(file, &header);
+            if (header.compare(0, key.size(), key) != 0) {
+                return false;
+            }
+            sys = std::move(s);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Ignoring cache entry " << file << ": " << e.what()
+                << std::endl;
+            return false;
+        }
+        if (provenance) {
+            *provenance = "# cached result: " + file + "\n" + header;
+        }
+        return true;
+    }
+
+    void Cache::store(const std::string& key, const System& sys,
+                      const std::string& provenance) const
+    {
+        if (!enabled()) {
+            return;
+        }
+        string file = path(key);
+        string tmp = file + ".tmp." + std::to_string(getpid());
+        make_shared_dir(dir);
+        make_shared_dir(file.substr(0, file.rfind('/')));
+        try {
+            std::ofstream out(tmp, std::ios::binary);
+            write_binary(out, sys, key + "#\n" + provenance);
+            out.close();
+            if (!out) {
+                throw std::runtime_error("cannot write " + tmp);
+            }
+            chmod(tmp.c_str(), 0664);
+            if (std::rename(tmp.c_str(), file.c_str()) != 0) {
+                throw std::runtime_error("cannot rename " + tmp);
+            }
+        }
+        catch (const std::exception& e) {
+            std::remove(tmp.c_str());
+            std::cerr << "Cannot store cache entry " << file << ": "
+                << e.what() << std::endl;
+        }
+    }
+
+}
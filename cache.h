@@ -0,0 +1,82 @@
+// Content-addressed cache of computed systems, so that repeated runs of the
+// same operation on the same input return the stored result instead of
+// recomputing it.
+//
+// An entry is keyed by
+//
+//  - the operation with all parameters that affect the result,
+//  - a digest of the exact input rows in their order. Equalities are
+//    hashed as the pairs of opposite inequalities that follow the
+//    inequalities in a text file, so a binary file and its conversion to
+//    text have the same digest. The rows are not normalized otherwise:
+//    reordered or scaled rows, or equality pairs at other positions of a
+//    text file, give a different key (and are recomputed), and
+//  - the git commit of the build (git::commit_info).
+//
+// and stored as binary system file (see sysfile.h) <DIR>/<xx>/<key>.sys,
+// whose provenance repeats the key fields (checked on load to rule out hash
+// collisions) followed by the header of the run that computed it.
+//
+// The cache directory is taken from --cache=DIR, else from $CFME_CACHE,
+// else it is ./results if that directory exists (i.e. when running from
+// the repository root). --no-cache disables the cache. Builds with
+// uncommitted changes never use the cache, because the commit does not
+// identify their code. Entries are written atomically (renamed into place),
+// so a directory can be shared by concurrent runs. To share it between
+// users, give it a common group, make it group writable and set the setgid
+// bit (chmod 2775): the subdirectories created by the cache get the same
+// mode and the entries are group writable, independent of the umask.
+
+#ifndef __CACHE_H__INCLUDED__
+#define __CACHE_H__INCLUDED__
+
+# include <initializer_list>
+# include <string>
+
+# include "fm.h"
+# include "util.h"      // Args
+
+
+namespace fm
+{
+
+    // digest of the rows in order (see above)
+    std::string digest(const System& s);
+
+    class Cache
+    {
+        std::string dir;            // empty if disabled
+
+        std::string path(const std::string& key) const;
+    public:
+        explicit Cache(const util::Args& args);
+
+        bool enabled() const;
+
+        // Operation string "NAME --OPT=VALUE..." from those of the given
+        // options that are present on the command line
+        static std::string operation(
+                const std::string& name, const util::Args& args,
+                std::initializer_list<const char*> options);
+
+        // Key of the operation applied to the input (nullptr if the
+        // operation has no input system). This is the text of the key
+        // fields, the file name is a hash of it (empty if disabled, to skip
+        // the digest).
+        std::string key(const std::string& operation,
+                        const System* input=nullptr) const;
+
+        // Returns false on a miss. The provenance is the header of the
+        // computing run, preceded by a "# cached result:" line.
+        bool load(const std::string& key, System& sys,
+                  std::string* provenance=nullptr) const;
+
+        // Store the result (errors are only reported on STDERR, a failing
+        // cache should not fail the computation)
+        void store(const std::string& key, const System& sys,
+                   const std::string& provenance) const;
+    };
+
+}
+
+#endif  // include guard
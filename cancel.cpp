@@ -0,0 +1,84 @@
+// Cancellation tokens, see cancel.h.
+
+#include <csignal>
+
+#include <signal.h>     // sigaction
+
+#include "cancel.h"
+#include "memory.h"
+
+
+namespace fm
+{
+
+    static volatile std::sig_atomic_t caught_signal = 0;
+
+    static void on_signal(int sig)
+    {
+        caught_signal = sig;
+    }
+
+    CancelToken::CancelToken()
+        : why(nullptr)
+    {
+    }
+
+    bool CancelToken::cancelled() const
+    {
+        return why.load(std::memory_order_relaxed) != nullptr;
+    }
+
+    const char* CancelToken::reason() const
+    {
+        return why.load();
+    }
+
+    void CancelToken::cancel(const char* reason)
+    {
+        const char* none = nullptr;
+        why.compare_exchange_strong(none, reason);
+    }
+
+    bool CancelToken::poll()
+    {
+        if (caught_signal == SIGINT) {
+            cancel("SIGINT");
+        }
+        if (caught_signal == SIGUSR1) {
+            cancel("SIGUSR1");
+        }
+        if (max_wall <= 0 && max_cpu <= 0 && max_rss == 0) {
+            return cancelled();
+        }
+        boost::timer::cpu_times t = timer.elapsed();
+        if (max_wall > 0 && t.wall / 1e9 > max_wall) {
+            cancel("wall time");
+        }
+        if (max_cpu > 0 && (t.user + t.system) / 1e9 > max_cpu) {
+            cancel("CPU time");
+        }
+        // (reading the RSS is more expensive, so it is only done every
+        // rss_interval)
+        if (max_rss > 0 && t.wall >= next_rss_check) {
+            next_rss_check = t.wall + rss_interval;
+            if (memory::current_rss() > max_rss) {
+                cancel("memory");
+            }
+        }
+        return cancelled();
+    }
+
+    // Only the first signal is caught (SA_RESETHAND), a second one takes
+    // the default action. This still terminates phases that never poll,
+    // like the final consistency checks or find_implicit_equalities.
+    void CancelToken::catch_signals()
+    {
+        struct sigaction action;
+        action.sa_handler = on_signal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESETHAND;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGUSR1, &action, nullptr);
+    }
+
+}
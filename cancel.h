@@ -0,0 +1,52 @@
+// Cooperative cancellation of long runs.
+//
+// The algorithms poll the token at safe points (between elimination steps,
+// between the candidates of a step and between minimize rounds) and stop
+// early, leaving a valid but incomplete result: minimize keeps the rows it
+// has not tested, and solve_to keeps the rows that do not involve any of
+// the columns still to be eliminated, i.e. an outer approximation of the
+// projection.
+
+#ifndef __CANCEL_H__INCLUDED__
+#define __CANCEL_H__INCLUDED__
+
+# include <atomic>
+# include <cstddef>     // size_t
+
+# include <boost/timer/timer.hpp>
+
+
+namespace fm
+{
+
+    class CancelToken
+    {
+        std::atomic<const char*> why;
+        boost::timer::cpu_timer timer;
+        boost::timer::nanosecond_type next_rss_check = 0;
+        static const boost::timer::nanosecond_type rss_interval = 100000000;
+    public:
+        // budgets checked by poll() (0 = unlimited):
+        double max_wall = 0;        // seconds
+        double max_cpu = 0;         // seconds
+        size_t max_rss = 0;         // bytes
+
+        CancelToken();
+
+        // cheap check (no budgets)
+        bool cancelled() const;
+        // the reason given to cancel(), or null
+        const char* reason() const;
+        void cancel(const char* reason);
+
+        // check budgets and signals, returns cancelled()
+        bool poll();
+
+        // cancel all tokens that poll() on SIGINT and SIGUSR1 (a second
+        // signal terminates the process)
+        static void catch_signals();
+    };
+
+}
+
+#endif  // include guard
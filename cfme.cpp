@@ -0,0 +1,389 @@
+// Run a pipeline of operations on a system in a single process, e.g. the
+// time evolution of a CCA:
+//
+//      cfme init-cca=3 minimize eliminate=8 next-layer=3 minimize eliminate=8
+//
+// The system is passed from stage to stage in memory, and each stage is
+// timed (on STDERR and in the output header). Stages:
+//
+//   read[=FILE]                read a system (text or binary, default STDIN)
+//   elemental=N                elemental inequalities of N variables
+//   iid=NF,NI                  mutual independence of the initial layer
+//   causal=NF,NI,LINKS         causal constraints of a two-layer CCA
+//   init-cca=W[,LINKS[,NI]]    elemental + iid + causal (see init-cca)
+//   next-layer=W[,LINKS[,NI]]  elemental + causal, with the current system
+//                              as constraints on the first layer (see
+//                              next-layer)
+//   minimize                   remove redundant rows (skipped if the system
+//                              is already minimal)
+//   eliminate=TO               eliminate all but the first TO columns and
+//                              minimize, stop if a resulting row is not
+//                              implied by the input (see eliminate)
+//   check-shift                stop unless the system is invariant under
+//                              the cyclic shifts of a two-layer CCA
+//   write[=FILE]               write the system (default STDOUT)
+//
+// The result is written to STDOUT unless the last stage is a write. Options:
+//
+//   --binary, --compact, --sparse     output format, see sysfile.h
+//   --shift                    minimize the result of eliminate orbit-wise
+//                              under the shift symmetry (stops unless the
+//                              input of eliminate is invariant)
+//   --schedule=NAME, --minimize-growth=F, --minimize-pn=N,
+//   --minimize-redundancy=F, --minimize-probe=K, --minimize-partial,
+//   --reduce
+//                              see eliminate
+//   --max-wall=SEC, --max-cpu=SEC
+//                              stop the pipeline early (the current stage
+//                              keeps an outer approximation, see cancel.h)
+//   --cache=DIR, --no-cache    result cache for the minimize and eliminate
+//                              stages, shared with the minimize_system and
+//                              eliminate tools (see cache.h)
+
+#include <cstdlib>          // atol, atof
+#include <fstream>
+#include <iomanip>          // setw
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>          // move
+#include <vector>
+
+#include <boost/timer/timer.hpp>
+
+#include "fm.h"
+#include "cache.h"
+#include "cancel.h"
+#include "symmetry.h"
+#include "sysfile.h"
+#include "util.h"
+#include "number.h"         // intlog2
+
+using namespace std;
+
+
+struct Stage
+{
+    string name;
+    vector<long> args;
+    string file;
+
+    string str() const
+    {
+        string s = name;
+        for (size_t i = 0; i < args.size(); ++i) {
+            s += (i ? "," : "=") + to_string(args[i]);
+        }
+        if (!file.empty()) {
+            s += "=" + file;
+        }
+        return s;
+    }
+};
+
+Stage parse_stage(const string& spec)
+{
+    Stage stage;
+    size_t eq = spec.find('=');
+    stage.name = spec.substr(0, eq);
+    if (eq == string::npos) {
+        return stage;
+    }
+    string value = spec.substr(eq+1);
+    if (stage.name == "read" || stage.name == "write") {
+        stage.file = value;
+        return stage;
+    }
+    istringstream in(value);
+    for (string arg; getline(in, arg, ','); ) {
+        stage.args.push_back(atol(arg.c_str()));
+    }
+    return stage;
+}
+
+
+class Pipeline
+{
+    util::Args args;
+    util::AutogenNotice gen;
+    fm::IO io;
+    fm::CancelToken cancel;
+    fm::Cache cache;
+    fm::System sys;
+    bool minimal = false;       // no redundant rows
+    vector<string> timings;
+
+    long arg(const Stage& s, size_t i, long def=-1) const
+    {
+        if (i < s.args.size()) {
+            return s.args[i];
+        }
+        if (def < 0) {
+            throw runtime_error("Missing argument for stage: " + s.name);
+        }
+        return def;
+    }
+
+    string cache_key(const Stage& s) const;
+    void cca(const Stage& s, bool iid);
+    bool eliminate(int to);
+    bool check_shift() const;
+    void write(const string& file);
+
+public:
+    Pipeline(int argc, char** argv);
+    bool run(const Stage& stage);
+    bool run();
+};
+
+
+Pipeline::Pipeline(int argc, char** argv)
+    : args(argc, argv)
+    , gen(argc, argv)
+    , io(&cerr)
+    , cache(args)
+    , sys(0, 0)
+{
+    cancel.max_wall = atof(args.get("max-wall", "0").c_str());
+    cancel.max_cpu = atof(args.get("max-cpu", "0").c_str());
+    fm::CancelToken::catch_signals();
+    io.cancel = &cancel;
+}
+
+// Two-layer CCA (see init-cca and next-layer). For next-layer, the current
+// system constrains the first (most significant) variables:
+void Pipeline::cca(const Stage& s, bool iid)
+{
+    size_t nf = arg(s, 0);
+    size_t nl = arg(s, 1, 2);
+    size_t ni = arg(s, 2, nf);
+    fm::System prev = move(sys);
+    sys = fm::elemental_inequalities(nf + ni);
+    if (iid) {
+        fm::set_initial_state_iid(sys, nf, ni);
+    }
+    fm::add_causal_constraints(sys, nf, ni, nl);
+    if (!iid) {
+        prev.split_equalities();
+        for (auto&& v : prev.ineqs) {
+            sys.add_inequality(v.injection(sys.num_cols, nf));
+        }
+    }
+    minimal = false;
+}
+
+// Same keys as the eliminate and minimize_system tools, built only from
+// the options the stage applies (e.g. not --purge), empty if the stage is
+// not cached:
+string Pipeline::cache_key(const Stage& s) const
+{
+    if (s.name == "minimize" && !minimal) {
+        return cache.key("minimize", &sys);
+    }
+    if (s.name == "eliminate") {
+        return cache.key(fm::Cache::operation(
+                "eliminate " + to_string(arg(s, 0)), args, {
+                "minimize-growth", "minimize-pn", "minimize-redundancy",
+                "minimize-probe", "minimize-partial", "reduce", "schedule",
+                "shift"}), &sys);
+    }
+    return "";
+}
+
+bool Pipeline::eliminate(int to)
+{
+    fm::MinimizePolicy policy;
+    policy.growth = atof(args.get("minimize-growth", "0").c_str());
+    policy.max_pn = atol(args.get("minimize-pn", "0").c_str());
+    policy.redundancy = atof(args.get("minimize-redundancy", "0").c_str());
+    policy.probe = atol(args.get("minimize-probe", "8").c_str());
+    policy.partial = args.has("minimize-partial");
+    policy.reduce = args.has("reduce");
+    auto schedule = fm::parse_schedule(args.get("schedule", "pos-major"));
+
+    // The input is kept to check the invariance and the result, as in the
+    // eliminate tool:
+    fm::Problem orig_lp = sys.problem();
+    fm::Group group;
+    if (args.has("shift")) {
+        sys.split_equalities();
+        group = fm::shift_group(intlog2(sys.num_cols)/2);
+        for (auto&& v : fm::expand(sys.ineqs, group)) {
+            if (!orig_lp.is_redundant(v.values)) {
+                cerr << "  not invariant, missing: " << v << endl;
+                return false;
+            }
+        }
+    }
+    sys.find_equalities();
+
+    fm::solve_to{sys, to, policy, schedule, 0, 0, fm::SolveState(), nullptr,
+                 &cancel}
+        .run(fm::SolveToStatusOutput(io));
+    fm::Group final_group;
+    if (!cancel.cancelled()) {
+        final_group = fm::restrict_group(group, to);
+        fm::close_rows(sys, final_group);
+    }
+    fm::minimize{sys, fm::minimize::REVERSE, nullptr, 0,
+                 fm::nontrivial(final_group), &cancel}
+        .run(fm::MinimizeStatusOutput(io));
+    minimal = !cancel.cancelled();
+
+    // (false positives would be a bug in the FM algorithm)
+    bool consistent = true;
+    for (auto&& v : sys.ineqs) {
+        if (!orig_lp.is_redundant(v.injection(orig_lp.num_cols).values)) {
+            cerr << "  FALSE: " << v << endl;
+            consistent = false;
+        }
+    }
+    for (auto&& v : sys.eqs) {
+        fm::Vector w = v.injection(orig_lp.num_cols);
+        if (!orig_lp.is_redundant(w.values) ||
+                !orig_lp.is_redundant(fm::ValArray(-w.values))) {
+            cerr << "  FALSE: " << v << " = 0" << endl;
+            consistent = false;
+        }
+    }
+    return consistent;
+}
+
+// Every shifted row must be implied by the system (see
+// check_shift_invariance):
+bool Pipeline::check_shift() const
+{
+    fm::Problem lp = sys.problem();
+    fm::Group group = fm::shift_group(intlog2(sys.num_cols)/2);
+    bool success = true;
+    for (auto&& v : fm::expand(sys.ineqs, group)) {
+        if (!lp.is_redundant(v.values)) {
+            cerr << "  no shift: " << v << endl;
+            success = false;
+        }
+    }
+    return success;
+}
+
+void Pipeline::write(const string& file)
+{
+    std::ostringstream header;
+    header << gen.str() << endl;
+    if (cancel.cancelled()) {
+        header << "# cancelled:    " << cancel.reason()
+            << " (outer approximation)" << endl;
+    }
+    header << "#\n# Stages:";
+    for (auto&& line : timings) {
+        header << "\n#   " << line;
+    }
+    header << "\n" << endl;
+    if (file.empty()) {
+        fm::write_system(cout, sys, header.str(), fm::output_format(args));
+    }
+    else {
+        ofstream out(file, ios::binary);
+        fm::write_system(out, sys, header.str(), fm::output_format(args));
+    }
+}
+
+bool Pipeline::run(const Stage& s)
+{
+    cerr << "== " << s.str() << endl;
+    boost::timer::cpu_timer timer;
+    bool ok = true;
+    string key = cache_key(s);
+    bool cached = !key.empty() && cache.load(key, sys);
+    if (cached) {
+        minimal = true;
+    }
+    else if (s.name == "read") {
+        sys = s.file.empty() ? fm::read_system(cin) : fm::read_system(s.file);
+        minimal = false;
+    }
+    else if (s.name == "elemental") {
+        sys = fm::elemental_inequalities(arg(s, 0));
+        minimal = true;
+    }
+    else if (s.name == "iid") {
+        fm::set_initial_state_iid(sys, arg(s, 0), arg(s, 1));
+        minimal = false;
+    }
+    else if (s.name == "causal") {
+        fm::add_causal_constraints(sys, arg(s, 0), arg(s, 1), arg(s, 2));
+        minimal = false;
+    }
+    else if (s.name == "init-cca") {
+        cca(s, true);
+    }
+    else if (s.name == "next-layer") {
+        cca(s, false);
+    }
+    else if (s.name == "minimize") {
+        if (!minimal) {
+            fm::minimize{sys, fm::minimize::REVERSE, nullptr, 0, nullptr,
+                         &cancel}
+                .run(fm::MinimizeStatusOutput(io));
+            minimal = !cancel.cancelled();
+        }
+    }
+    else if (s.name == "eliminate") {
+        ok = eliminate(arg(s, 0));
+    }
+    else if (s.name == "check-shift") {
+        ok = check_shift();
+    }
+    else if (s.name == "write") {
+        write(s.file);
+    }
+    else {
+        throw runtime_error("Unknown stage: " + s.name);
+    }
+    if (ok && !key.empty() && !cached && !cancel.cancelled()) {
+        cache.store(key, sys, gen.str() + "\n# stage: " + s.str() + "\n");
+    }
+    timings.push_back(util::sprint_all(
+                setw(20), left, s.str(), right,
+                setw(8), sys.ineqs.size() + 2*sys.eqs.size(), " rows  ",
+                timer.format(3, "%ws wall, %ts CPU"),
+                cached ? " (cached)" : ""));
+    cerr << "   " << timings.back() << "\n" << endl;
+    return ok;
+}
+
+bool Pipeline::run()
+{
+    vector<Stage> stages;
+    for (auto&& spec : args.pos) {
+        stages.push_back(parse_stage(spec));
+    }
+    for (auto&& stage : stages) {
+        if (cancel.poll()) {
+            break;
+        }
+        if (!run(stage)) {
+            cerr << "Stage failed: " << stage.str() << endl;
+            return false;
+        }
+    }
+    if (stages.empty() || stages.back().name != "write") {
+        write("");
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv, char** env)
+try
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " STAGE... [OPTIONS]" << endl;
+        return 1;
+    }
+    Pipeline pipeline(argc, argv);
+    return pipeline.run() ? 0 : 1;
+}
+catch (...)
+{
+    throw;
+}
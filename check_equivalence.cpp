@@ -1,5 +1,10 @@
 // Check if two systems of inequalities are equivalent
+//
+// With --symmetry the column permutations that leave both systems invariant
+// are detected and only one row per orbit is checked.
 #include "fm.h"
+#include "sysfile.h"
+#include "symmetry.h"
 
 #include <fstream>
 #include <string>
@@ -16,7 +21,7 @@ using fm::Matrix;
 // business logic
 //----------------------------------------
 
-Matrix unimplied(const Matrix& a, const Matrix& b)
+Matrix unimplied(const Matrix& a, const Matrix& b, const fm::Group& g)
 {
     Matrix r;
     if (a.empty() && b.empty())
@@ -34,10 +39,14 @@ Matrix unimplied(const Matrix& a, const Matrix& b)
         assert_eq_size(num_vars_a, num_vars_b);
         num_vars = num_vars_a;
     }
+    // Both systems are invariant under the group, so a row is implied if
+    // and only if the representative of its orbit is implied:
     lp::Problem lp = problem(a, num_vars);
-    for (auto&& v : b) {
-        if (!lp.is_redundant(v.values)) {
-            r.push_back(v.copy());
+    for (auto&& orbit : fm::row_orbits(b, g)) {
+        if (!lp.is_redundant(b[orbit[0]].values)) {
+            for (size_t i : orbit) {
+                r.push_back(b[i].copy());
+            }
         }
     }
     return r;
@@ -45,9 +54,10 @@ Matrix unimplied(const Matrix& a, const Matrix& b)
 
 
 bool check_implies(string label_a, const Matrix& sys_a,
-                   string label_b, const Matrix& sys_b)
+                   string label_b, const Matrix& sys_b,
+                   const fm::Group& g)
 {
-    Matrix missing = unimplied(sys_a, sys_b);
+    Matrix missing = unimplied(sys_a, sys_b, g);
     if (missing.empty()) {
         cout << label_a << " implies " << label_b << endl;
         return true;
@@ -65,24 +75,31 @@ int main(int argc, char** argv, char** env)
 try
 {
     int error_level = 0;
+    util::Args args(argc, argv);
 
-    if (argc == 3) {
-        string file_a = argv[1];
-        string file_b = argv[2];
-        Matrix sys_a = fm::parse_matrix(util::read_file(file_a));
-        Matrix sys_b = fm::parse_matrix(util::read_file(file_b));
+    if (args.pos.size() == 2) {
+        string file_a = args.pos[0];
+        string file_b = args.pos[1];
+        Matrix sys_a = fm::read_matrix(file_a);
+        Matrix sys_b = fm::read_matrix(file_b);
         string label_a = "A";
         string label_b = "B";
-        if (!check_implies(label_a, sys_a, label_b, sys_b)) {
+        fm::Group group;
+        if (args.has("symmetry")) {
+            group = fm::symmetry_group(
+                    vector<const Matrix*>{&sys_a, &sys_b});
+            cerr << "Symmetry group of order " << group.order << endl;
+        }
+        if (!check_implies(label_a, sys_a, label_b, sys_b, group)) {
             error_level |= 1;
         }
-        if (!check_implies(label_b, sys_b, label_a, sys_a)) {
+        if (!check_implies(label_b, sys_b, label_a, sys_a, group)) {
             error_level |= 2;
         }
     }
 
     else {
-        cout << "Usage: check FILENAME FILENAME" << endl;
+        cout << "Usage: check FILENAME FILENAME [--symmetry]" << endl;
         error_level = 4;
     }
 
@@ -1,5 +1,6 @@
 // Check if two systems of inequalities are equivalent
 #include "fm.h"
+#include "sysfile.h"
 
 #include <fstream>
 #include <string>
@@ -74,7 +75,7 @@ try
 
     if (argc == 2) {
         string file = argv[1];
-        System sys = fm::parse_matrix(util::read_file(file));
+        System sys = fm::read_matrix(file);
         if (!check_shift_invariance(sys)) {
             error_level = 1;
         }
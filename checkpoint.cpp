@@ -0,0 +1,142 @@
+// Checkpoints, see checkpoint.h.
+
+#include <cstdio>       // rename
+#include <fstream>
+#include <sstream>
+#include <stdexcept>    // runtime_error
+#include <utility>      // move
+
+#include <fcntl.h>      // open
+#include <unistd.h>     // fsync, close
+
+#include "checkpoint.h"
+#include "sysfile.h"
+
+
+namespace fm
+{
+
+    Checkpoint::Checkpoint(std::string f, int to, const std::string& input)
+        : filename(f)
+    {
+        std::ostringstream lines;
+        lines << "# to: " << to << "\n"
+            << "# input: " << input << "\n";
+        job = lines.str();
+    }
+
+    Checkpoint::~Checkpoint()
+    {
+        if (syncer.joinable()) {
+            syncer.join();
+        }
+    }
+
+    // Write to a temporary file first, so that a crash while writing leaves
+    // the previous checkpoint intact:
+    void Checkpoint::save(const System& sys, const SolveState& state)
+    {
+        wait();
+        std::string tmp = filename + ".tmp";
+        write(tmp, sys, state);
+        syncer = std::thread([this, tmp] {
+            try {
+                commit(tmp);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        });
+    }
+
+    void Checkpoint::wait()
+    {
+        if (syncer.joinable()) {
+            syncer.join();
+        }
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    void Checkpoint::write(const std::string& tmp, const System& sys,
+                           const SolveState& state) const
+    {
+        std::ostringstream header;
+        header << "# checkpoint\n"
+            << job
+            << "# num_cols: " << sys.num_cols << "\n"
+            << "# step: " << state.step << "\n"
+            << "# num_minimized: " << state.num_minimized << "\n"
+            << "# num_tested: " << state.num_tested << "\n"
+            << "# rate: " << state.rate << "\n"
+            << "# order:";
+        for (int index : state.order) {
+            header << ' ' << index;
+        }
+        header << "\n";
+        std::ofstream out(tmp, std::ios::binary);
+        write_binary(out, sys, header.str());
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Cannot write checkpoint: " + tmp);
+        }
+    }
+
+    void Checkpoint::commit(const std::string& tmp) const
+    {
+        int fd = open(tmp.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+        if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+            throw std::runtime_error("Cannot replace checkpoint: " + filename);
+        }
+    }
+
+    bool Checkpoint::load(System& sys, SolveState& state) const
+    {
+        if (!std::ifstream(filename)) {
+            return false;
+        }
+        std::string header;
+        System s = read_system(filename, &header);
+        std::istringstream lines(header);
+        std::string saved_job;
+        for (std::string line; std::getline(lines, line); ) {
+            if (line.compare(0, 2, "# ") != 0) {
+                continue;
+            }
+            std::istringstream fields(line.substr(2));
+            std::string key;
+            fields >> key;
+            if (key == "to:" || key == "input:")
+                saved_job += line + "\n";
+            if (key == "step:")
+                fields >> state.step;
+            if (key == "num_minimized:")
+                fields >> state.num_minimized;
+            if (key == "num_tested:")
+                fields >> state.num_tested;
+            if (key == "rate:")
+                fields >> state.rate;
+            if (key == "order:") {
+                state.order.clear();
+                for (int index; fields >> index; ) {
+                    state.order.push_back(index);
+                }
+            }
+        }
+        if (saved_job != job) {
+            throw std::runtime_error(
+                    "Checkpoint " + filename + " belongs to a different run "
+                    "(the input or TO differ).");
+        }
+        sys = std::move(s);
+        return true;
+    }
+
+}
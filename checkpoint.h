@@ -0,0 +1,63 @@
+// Checkpoints of long solve_to runs, from which the elimination can be
+// resumed after a crash or preemption.
+//
+// A checkpoint is a binary system file (readable by all tools, see
+// sysfile.h) that keeps the equality block, with the state of the run
+// stored in the provenance comments:
+//
+//      # checkpoint
+//      # to: 16
+//      # input: 64 cols, 2321 rows, 5f0c...
+//      # num_cols: 64
+//      # step: 12
+//      # order: 63 62 ...
+//      ...
+//      <rows>
+//
+// The `to` and `input` lines identify the run (the number of columns to
+// keep and the digest of the input system, see cache.h). A checkpoint of a
+// different run is never resumed.
+
+#ifndef __CHECKPOINT_H__INCLUDED__
+#define __CHECKPOINT_H__INCLUDED__
+
+# include <exception>   // exception_ptr
+# include <string>
+# include <thread>
+
+# include "fm.h"
+
+
+namespace fm
+{
+
+    class Checkpoint
+    {
+        std::string filename;
+        std::string job;                // the `to` and `input` lines
+        std::thread syncer;
+        std::exception_ptr error;       // of the last sync
+
+        void write(const std::string& tmp, const System& sys,
+                   const SolveState& state) const;
+        void commit(const std::string& tmp) const;
+    public:
+        Checkpoint(std::string filename, int to, const std::string& input);
+        ~Checkpoint();
+
+        // Save the system and state. The system is serialized directly on
+        // the calling thread (a copy would double the peak memory of the
+        // run). Only syncing the file to disk and replacing the previous
+        // checkpoint happen on a background thread.
+        void save(const System& sys, const SolveState& state);
+        // wait for the pending sync (rethrows its errors)
+        void wait();
+
+        // Returns false if there is no checkpoint, throws if it belongs to
+        // a different run.
+        bool load(System& sys, SolveState& state) const;
+    };
+
+}
+
+#endif  // include guard
@@ -0,0 +1,52 @@
+// - read a system in text or binary form from FILE (or STDIN)
+// - write it to STDOUT in text form (without padding with --compact, or as
+//   col:coef pairs with --sparse), or in binary form with --binary
+//
+// The comment header of text files is kept as the provenance of binary
+// files and vice versa. With --binary, the sparse layout is used if at most
+// 25% of the coefficients are nonzero (--sparse and --dense force either).
+
+#include <iostream>
+#include <string>
+
+#include "fm.h"
+#include "sysfile.h"
+
+#include "util.h"
+
+using namespace std;
+
+
+int main(int argc, char** argv, char** env)
+try
+{
+    util::Args args(argc, argv);
+    if (args.pos.size() > 1) {
+        cerr << "Usage: " << argv[0]
+            << " [FILE] [--compact | --sparse | --binary [--sparse|--dense]]"
+            << endl;
+        return 1;
+    }
+
+    string provenance;
+    fm::System system = args.pos.empty()
+        ? fm::read_system(cin, &provenance)
+        : fm::read_system(args.pos[0], &provenance);
+
+    cerr << system.ineqs.size() << " inequalities, "
+        << system.eqs.size() << " equalities, "
+        << system.num_cols << " columns" << endl;
+
+    if (args.has("binary")) {
+        double fill = args.has("sparse") ? 1 : args.has("dense") ? -1 : 0.25;
+        fm::write_binary(cout, system, provenance, fill);
+    }
+    else {
+        fm::write_system(cout, system, provenance, fm::output_format(args));
+    }
+    return 0;
+}
+catch (...)
+{
+    throw;
+}
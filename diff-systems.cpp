@@ -2,6 +2,7 @@
 // difference.
 
 #include "fm.h"
+#include "sysfile.h"
 
 #include <fstream>
 #include <string>
@@ -72,8 +73,8 @@ try
     if (argc == 3) {
         string file_a = argv[1];
         string file_b = argv[2];
-        Matrix sys_a = fm::parse_matrix(util::read_file(file_a));
-        Matrix sys_b = fm::parse_matrix(util::read_file(file_b));
+        Matrix sys_a = fm::read_matrix(file_a);
+        Matrix sys_b = fm::read_matrix(file_b);
         string label_a = "A";
         string label_b = "B";
         if (!check_implies(label_a, sys_a, label_b, sys_b)) {
@@ -1,19 +1,40 @@
+// - print the elemental inequalities for NUM_VARS random variables
+//
+// With --sparse the rows are written as col:coef pairs without ever being
+// stored densely, which is the only practical form for larger NUM_VARS.
+// --compact and --binary select the other output formats (see sysfile.h).
+
+#include <cstdlib>      // atol
 #include <iostream>
 
 #include "fm.h"
+#include "sysfile.h"
+#include "util.h"
 
 using namespace std;
 
 
 int main(int argc, char** argv)
 {
-    if (argc != 2) {
-        cerr << "Usage: " << argv[0] << " NUM_VARS" << endl;
+    util::Args args(argc, argv);
+    if (args.pos.size() != 1) {
+        cerr << "Usage: " << argv[0]
+            << " NUM_VARS [--compact | --sparse | --binary]" << endl;
         return 1;
     }
 
-    size_t num_vars = atol(argv[1]);
-    fm::System eli = fm::elemental_inequalities(num_vars);
-    cout << eli << endl;
+    size_t num_vars = atol(args.pos[0].c_str());
+    fm::Format format = fm::output_format(args);
+    if (format == fm::BINARY) {
+        fm::System eli = fm::elemental_inequalities(num_vars);
+        fm::write_system(cout, eli, "", format);
+        return 0;
+    }
+    fm::TextWriter out(cout, format, true);
+    out.write_dim(1 << num_vars);
+    for (auto&& v : fm::sparse_elemental_inequalities(num_vars)) {
+        out.write(v);
+    }
+    out.flush();
     return 0;
 }
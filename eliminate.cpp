@@ -4,34 +4,234 @@
 // - print system to STDOUT
 //
 // Status updates are shown on STDERR
+//
+// Options for minimizing in between elimination steps:
+//
+//   --minimize-growth=F        row count grew by factor F since last minimize
+//   --minimize-pn=N            predicted p*n of the next step exceeds N
+//   --minimize-redundancy=F    last minimize removed at least fraction F
+//   --minimize-probe=K         ... or every K steps (default 8), so that a
+//                              low rate is measured again
+//   --minimize-partial         skip the rows that passed the last minimize
+//                              and carried over unchanged
+//   --reduce                   move implicit equalities into the equality
+//                              block at the start and before each minimize
+//
+// Options for each elimination step:
+//
+//   --schedule=NAME            order in which candidates are checked
+//                              (pos-major, sparsest, norm, origin)
+//   --purge=N                  minimize the new rows after N accepted rows
+//   --memory=MB                memory for the sorted candidate list, larger
+//                              lists are sorted in runs on disk
+//   --show-memory              show the memory usage in the status line
+//
+// The peak memory usage (per subsystem, see memory.h) is written to the
+// header of the output, along with the peaks of each elimination step.
+//
+// Options for exploiting symmetries (see symmetry.h):
+//
+//   --symmetry                 detect the column permutations that leave the
+//                              input invariant
+//   --shift                    use the cyclic shifts of a two-layer CCA
+//
+// Options for long runs:
+//
+//   --checkpoint=FILE          save the current system and the state of the
+//                              run to FILE after each elimination step
+//   --resume                   continue from the checkpoint in FILE (if it
+//                              exists), refused unless the input and TO
+//                              are the same as for the initial run (the
+//                              other options should be the same as well)
+//   --max-wall=SEC             stop after SEC seconds of wall time
+//   --max-cpu=SEC              stop after SEC seconds of CPU time
+//   --max-rss=MB               stop once the process uses more than MB
+//
+// The run can also be stopped with SIGINT, SIGUSR1 or the 'c' key. The
+// output is then the outer approximation computed so far, i.e. the rows
+// that do not involve any of the columns still to be eliminated, and the
+// output header says so. A second SIGINT terminates the process at once.
+//
+// The input can be in text or binary form (see sysfile.h). The output is
+// written in binary form with --binary, as text without padding with
+// --compact, or as sparse col:coef text with --sparse.
+//
+// With --stream, the rows are written as soon as they are proven to be
+// facets of the final projection (rows that do not involve the columns to
+// be eliminated and survive a redundancy test). The rest of the result and
+// the header follow at the end, along with a "# stream complete" marker (or
+// "# stream incomplete: REASON" if the run was stopped early).
+//
+// The symmetries are verified against the input. The final minimize then
+// tests only one row per orbit of the symmetries that map the kept columns
+// onto themselves. The elimination steps do not use them (see symmetry.h).
+//
+// Completed results are kept in the result cache (see cache.h), so running
+// the same elimination on the same input again returns immediately:
+//
+//   --cache=DIR                cache directory (default: $CFME_CACHE, or
+//                              ./results if it exists)
+//   --no-cache                 neither look up nor store the result
 
 #include <cstdlib>          // atol
 #include <cstddef>
 #include <iomanip>          // setw
 #include <iostream>
+#include <iterator>         // begin
+#include <memory>           // unique_ptr
+#include <set>
+#include <sstream>
 #include <utility>          // move
 
 #include "fm.h"
+#include "cache.h"
+#include "cancel.h"
+#include "checkpoint.h"
+#include "symmetry.h"
+#include "sysfile.h"
 #include "util.h"
+#include "memory.h"
 #include "number.h"         // intlog2
 
 
 using std::cout;
 using std::cerr;
 using std::endl;
+using std::string;
 using std::vector;
 
 
+// Writes the rows that are proven to be facets of the final projection,
+// i.e. rows that do not involve the columns to be eliminated and have been
+// found irredundant in the current system (they stay irredundant, since
+// the later steps do not change the projection).
+struct FacetStream
+{
+    fm::TextWriter out;
+    size_t num_cols;
+    std::set<vector<fm::Value>> emitted;
+
+    FacetStream(fm::Format format, size_t n)
+        : out(cout, format)
+        , num_cols(n)
+    {
+        out.write("# streaming: rows are written as they are proven to be "
+                  "facets\n");
+        out.write_dim(num_cols);
+        out.flush();
+    }
+
+    void offer(const fm::ValArray& v)
+    {
+        for (size_t j = num_cols; j < v.size(); ++j) {
+            if (v[j]) {
+                return;
+            }
+        }
+        vector<fm::Value> row(std::begin(v), std::begin(v) + num_cols);
+        if (emitted.insert(row).second) {
+            out.write(fm::ValArray(row.data(), row.size()));
+        }
+    }
+
+    // write the rest of the final system and the completeness marker
+    void finish(const fm::System& s, const string& header, const char* why)
+    {
+        out.write(header);
+        for (auto&& v : s.ineqs) {
+            offer(v.values);
+        }
+        for (auto&& v : s.eqs) {
+            offer(v.values);
+            offer(-v.values);
+        }
+        if (why) {
+            out.write(string("# stream incomplete: ") + why + "\n");
+        }
+        else {
+            out.write("# stream complete\n");
+        }
+        out.flush();
+    }
+};
+
+
+struct StreamMinimize : fm::MinimizeStatusOutput
+{
+    FacetStream* stream;
+
+    typedef fm::MinimizeStatusOutput super;
+
+    StreamMinimize(const fm::IO& io, FacetStream* s)
+        : super(io)
+        , stream(s)
+    {
+    }
+
+    ~StreamMinimize()
+    {
+        if (stream) {
+            stream->out.flush();
+        }
+    }
+
+    void accepted(const fm::Vector& row) const override
+    {
+        if (stream) {
+            stream->offer(row.values);
+        }
+    }
+};
+
+
+struct RecordMinimize : StreamMinimize
+{
+    vector<string>* recorded_minimize;
+    string label;
+
+    typedef StreamMinimize super;
+
+    RecordMinimize(const fm::IO& io, FacetStream* s, vector<string>* r,
+                   string l)
+        : super(io, s)
+        , recorded_minimize(r)
+        , label(l)
+    {
+    }
+
+    ~RecordMinimize()
+    {
+        recorded_minimize->push_back(util::sprint_all(
+                    label, num_orig, " -> ", sys->ineqs.size()));
+    }
+};
+
+
 struct RecordOrder : fm::SolveToStatusOutput
 {
     vector<int>* recorded_order;
+    vector<string>* recorded_minimize;
+    vector<string>* recorded_memory;
+    FacetStream* stream;
 
     typedef fm::SolveToStatusOutput super;
 
-    RecordOrder(const fm::IO& io, vector<int>* r)
+    RecordOrder(const fm::IO& io, vector<int>* r, vector<string>* m,
+                vector<string>* mem, FacetStream* s)
         : super(io)
         , recorded_order(r)
+        , recorded_minimize(m)
+        , recorded_memory(mem)
+        , stream(s)
+    {
+    }
+
+    fm::SG finished_step(int step, const memory::Usage& peak) const override
     {
+        recorded_memory->push_back(util::sprint_all(
+                    "step ", std::setw(3), step, ": ",
+                    memory::summary(peak)));
+        return super::finished_step(step, peak);
     }
 
     fm::EliminatePtr start_eliminate(int index) const override
@@ -39,6 +239,14 @@ struct RecordOrder : fm::SolveToStatusOutput
         recorded_order->push_back(index);
         return super::start_eliminate(index);
     }
+
+    fm::MinimizePtr start_minimize(int step, const char* reason) const override
+    {
+        string label = util::sprint_all(
+                "step ", std::setw(3), step, " (", reason, "): ");
+        return fm::MinimizePtr(
+                new RecordMinimize(*this, stream, recorded_minimize, label));
+    }
 };
 
 
@@ -46,26 +254,136 @@ int main(int argc, char** argv, char** env)
 try
 {
     util::AutogenNotice gen(argc, argv);
+    util::Args args(argc, argv);
 
-    if (argc != 2) {
-        cerr << "Usage: " << argv[0] << " SOLVE_TO" << endl;
+    if (args.pos.size() != 1) {
+        cerr << "Usage: " << argv[0] << " SOLVE_TO [OPTIONS]" << endl;
         return 1;
     }
 
-    int solve_to = std::atol(argv[1]);
+    int solve_to = std::atol(args.pos[0].c_str());
     int width = intlog2(solve_to);
 
+    fm::MinimizePolicy policy;
+    policy.growth = std::atof(args.get("minimize-growth", "0").c_str());
+    policy.max_pn = std::atol(args.get("minimize-pn", "0").c_str());
+    policy.redundancy = std::atof(
+            args.get("minimize-redundancy", "0").c_str());
+    policy.probe = std::atol(args.get("minimize-probe", "8").c_str());
+    policy.partial = args.has("minimize-partial");
+    policy.reduce = args.has("reduce");
+
+    auto schedule = fm::parse_schedule(args.get("schedule", "pos-major"));
+    size_t purge = std::atol(args.get("purge", "0").c_str());
+    size_t budget = std::atol(args.get("memory", "0").c_str()) << 20;
+
+    fm::CancelToken cancel;
+    cancel.max_wall = std::atof(args.get("max-wall", "0").c_str());
+    cancel.max_cpu = std::atof(args.get("max-cpu", "0").c_str());
+    cancel.max_rss = std::atol(args.get("max-rss", "0").c_str()) << 20;
+    fm::CancelToken::catch_signals();
+
     fm::IO io(&cerr);
+    io.show_memory = args.has("show-memory");
+    io.cancel = &cancel;
 
-    fm::System system = fm::parse_matrix(util::read_file(std::cin));
+    fm::System system = fm::read_system(std::cin);
+    fm::Format format = fm::output_format(args);
+    // (identifies the run in checkpoints)
+    string input_digest = args.has("checkpoint") ? fm::digest(system) : "";
+
+    fm::Cache cache(args);
+    string cache_key = cache.key(fm::Cache::operation(
+            "eliminate " + std::to_string(solve_to), args, {
+            "minimize-growth", "minimize-pn", "minimize-redundancy",
+            "minimize-probe", "minimize-partial", "reduce", "schedule",
+            "purge", "symmetry", "shift"}), &system);
+    string cached_header;
+    if (cache.load(cache_key, system, &cached_header)) {
+        cerr << "Using cached result (" << system.ineqs.size()
+            << " inequalities)" << endl;
+        string header = gen.str() + "\n#\n" + cached_header + "\n";
+        if (args.has("stream") && format != fm::BINARY) {
+            FacetStream(format, solve_to).finish(system, header, nullptr);
+        }
+        else {
+            fm::write_system(cout, system, header, format);
+        }
+        return 0;
+    }
 
     // make a copy that can be used later to verify that inequalities
     // are indeed implied (consistency check for FM algorithm):
     fm::Problem orig_lp = system.problem();
 
-    vector<int> recorded_order;
-    fm::solve_to{system, solve_to}.run(RecordOrder(io, &recorded_order));
-    fm::minimize{system}.run(fm::MinimizeStatusOutput(io));
+    fm::Group group;
+    if (args.has("symmetry") || args.has("shift")) {
+        // (the group works on the inequalities, binary input may contain
+        // an equality block)
+        system.split_equalities();
+    }
+    if (args.has("symmetry")) {
+        group = fm::symmetry_group(system.ineqs);
+    }
+    else if (args.has("shift")) {
+        group = fm::shift_group(intlog2(system.num_cols)/2);
+    }
+    if (!group.gens.empty()) {
+        cerr << "Symmetry group of order " << group.order << endl;
+        for (auto&& v : fm::expand(system.ineqs, group)) {
+            if (!orig_lp.is_redundant(v.values)) {
+                cerr << "System is not invariant, missing: " << v << endl;
+                return 1;
+            }
+        }
+    }
+    size_t num_eqs = system.find_equalities();
+    cerr << "Found " << num_eqs << " equalities" << endl;
+
+    fm::SolveState state;
+    string checkpoint_file = args.get("checkpoint");
+    fm::Checkpoint checkpoint(checkpoint_file, solve_to, input_digest);
+    if (args.has("resume") && !checkpoint_file.empty()) {
+        fm::System saved(0, 0);
+        if (checkpoint.load(saved, state)) {
+            cerr << "Resuming from step " << state.step
+                << " (" << saved.ineqs.size() << " rows)" << endl;
+            system = std::move(saved);
+            system.find_equalities();
+        }
+    }
+
+    std::unique_ptr<FacetStream> stream;
+    if (args.has("stream")) {
+        if (format == fm::BINARY) {
+            cerr << "--stream requires a text format" << endl;
+            return 1;
+        }
+        stream.reset(new FacetStream(format, solve_to));
+    }
+
+    vector<int> recorded_order = state.order;
+    vector<string> recorded_minimize;
+    vector<string> recorded_memory;
+    fm::solve_to{system, solve_to, policy, schedule, purge, budget,
+                 state, checkpoint_file.empty() ? nullptr : &checkpoint,
+                 &cancel}
+        .run(RecordOrder(io, &recorded_order, &recorded_minimize,
+                         &recorded_memory, stream.get()));
+
+    // (the outer approximation of a cancelled run is not invariant)
+    fm::Group final_group;
+    if (!cancel.cancelled()) {
+        final_group = fm::restrict_group(group, solve_to);
+        fm::close_rows(system, final_group);
+    }
+    fm::minimize{system, fm::minimize::REVERSE, nullptr, 0,
+                 fm::nontrivial(final_group), &cancel}
+        .run(StreamMinimize(io, stream.get()));
+    if (cancel.cancelled()) {
+        cerr << "Cancelled (" << cancel.reason() << "), "
+            << "keeping the outer approximation computed so far\n" << endl;
+    }
 
     cerr << "Reduced to "
         << system.ineqs.size() << " inequalities and "
@@ -83,21 +401,58 @@ try
             consistent = false;
         }
     }
+    for (auto&& v : system.eqs) {
+        fm::Vector w = v.injection(orig_lp.num_cols);
+        if (!orig_lp.is_redundant(w.values) ||
+                !orig_lp.is_redundant(fm::ValArray(-w.values))) {
+            cerr << "   FALSE: " << v << " = 0" << endl;
+            consistent = false;
+        }
+    }
     cerr << endl;
     if (!consistent) {
+        if (stream) {
+            stream->finish(fm::System(0, solve_to), "",
+                           "consistency check failed");
+        }
         return 1;
     }
 
-    cout << gen.str() << endl;
-    cout << "\n# Elimination order:";
+    std::ostringstream header;
+    header << gen.str() << endl;
+    if (cancel.cancelled()) {
+        header << "# cancelled:    " << cancel.reason()
+            << " (outer approximation)" << endl;
+    }
+    header << "\n# Elimination order:";
     for (int i = 0; i < recorded_order.size(); ++i) {
         if (i % 10 == 0) {
-            cout << "\n#   ";
+            header << "\n#   ";
+        }
+        header << ' ' << std::setw(3) << recorded_order[i];
+    }
+    if (!recorded_minimize.empty()) {
+        header << "\n#\n# Intermediate minimizations:";
+        for (auto&& line : recorded_minimize) {
+            header << "\n#   " << line;
+        }
+    }
+    if (!recorded_memory.empty()) {
+        header << "\n#\n# Peak memory per step:";
+        for (auto&& line : recorded_memory) {
+            header << "\n#   " << line;
         }
-        cout << ' ' << std::setw(3) << recorded_order[i];
     }
-    cout << "\n" << endl;
-    cout << system << endl;
+    header << "\n" << endl;
+    if (!cancel.cancelled()) {
+        cache.store(cache_key, system, header.str());
+    }
+    if (stream) {
+        stream->finish(system, header.str(), cancel.reason());
+    }
+    else {
+        fm::write_system(cout, system, header.str(), format);
+    }
 
     return 0;
 }
@@ -1,11 +1,24 @@
 // Basic Fourier-Motzkin C++ API (eliminates variables from a system of
 // inequalities).
 
+#include <algorithm>    // sort, stable_sort, shuffle
+#include <cstdint>      // uint64_t
+#include <cstdio>       // tmpfile, fread, fwrite
 #include <iomanip>      // setw
+#include <map>
+#include <memory>       // align
+#include <queue>        // priority_queue
+#include <random>
+#include <set>
+#include <tuple>        // tie
 #include <utility>      // move
 
 #include "number.h"
 #include "fm.h"
+#include "kernels.h"
+#include "symmetry.h"
+#include "checkpoint.h"
+#include "cancel.h"
 #include "error.h"
 #include "util.h"
 
@@ -41,6 +54,9 @@ namespace fm
         for (auto&& v : ineqs) {
             s.add_inequality(v.copy());
         }
+        for (auto&& v : eqs) {
+            s.add_equality(v.copy());
+        }
         return s;
     }
 
@@ -48,6 +64,7 @@ namespace fm
     {
         ineqs.clear();
         ineqs.reserve(new_expected);
+        eqs.clear();
     }
 
     void System::add_equality(Vector&& vec)
@@ -55,9 +72,236 @@ namespace fm
         assert_eq_size(vec.size(), num_cols);
         if (vec.empty())
             return;
-        ineqs.push_back(vec.copy());
-        vec.values *= -1;
-        ineqs.push_back(move(vec));
+        vec.normalize();
+        eqs.push_back(move(vec));
+    }
+
+    // Opposite pairs are found by sorting the rows by their coefficients
+    // up to sign, so that both rows of a pair end up next to each other.
+    // The remaining inequalities keep their order.
+    size_t System::find_equalities()
+    {
+        auto flipped = [] (const Vector& v) {
+            for (Value x : v.values) {
+                if (x) {
+                    return x < 0;
+                }
+            }
+            return false;
+        };
+        std::vector<bool> flip(ineqs.size());
+        std::vector<size_t> idx(ineqs.size());
+        for (size_t i = 0; i < ineqs.size(); ++i) {
+            flip[i] = flipped(ineqs[i]);
+            idx[i] = i;
+        }
+        std::sort(idx.begin(), idx.end(), [&] (size_t a, size_t b) {
+            Value sa = flip[a] ? -1 : 1;
+            Value sb = flip[b] ? -1 : 1;
+            for (size_t j = 0; j < num_cols; ++j) {
+                Value x = sa*ineqs[a].get(j);
+                Value y = sb*ineqs[b].get(j);
+                if (x != y) {
+                    return x < y;
+                }
+            }
+            return sa > sb;
+        });
+
+        std::vector<bool> paired(ineqs.size());
+        for (size_t k = 0; k+1 < idx.size(); ++k) {
+            size_t i = idx[k], j = idx[k+1];
+            if (!flip[i] && flip[j] &&
+                    ineqs[i] == Vector(ValArray(-ineqs[j].values))) {
+                paired[i] = paired[j] = true;
+                ++k;
+            }
+        }
+
+        size_t num_found = 0;
+        Matrix rest;
+        for (size_t i = 0; i < ineqs.size(); ++i) {
+            if (!paired[i]) {
+                rest.push_back(move(ineqs[i]));
+            }
+            else if (!flip[i]) {
+                add_equality(move(ineqs[i]));
+                ++num_found;
+            }
+        }
+        ineqs = move(rest);
+        return num_found;
+    }
+
+    // With one auxiliary LP in (x, t):
+    //
+    //      max sum(t)  s.t.  a_i x >= t_i,  0 <= t_i <= 1,  e x = 0
+    //
+    // Since the feasible set is a cone, there is an x that is strictly
+    // positive on all rows that are not implicit equalities, so at the
+    // optimum t_i = 1 for all of them and t_i = 0 for the others.
+    size_t System::find_implicit_equalities()
+    {
+        size_t m = ineqs.size();
+        Vec<double> obj(num_cols + m);
+        Problem lp(num_cols + m);
+        for (size_t i = 0; i < m; ++i) {
+            Vec<double> v(num_cols + m);
+            for (size_t j = 0; j < num_cols; ++j) {
+                v[j] = ineqs[i].get(j);
+            }
+            v[num_cols+i] = -1;
+            lp.add_inequality(v);
+            lp.add_inequality(la::basis_vector<double>(num_cols+m, num_cols+i),
+                              0, 1);
+            obj[num_cols+i] = -1;
+        }
+        for (auto&& vec : eqs) {
+            Vec<double> v(num_cols + m);
+            for (size_t j = 0; j < num_cols; ++j) {
+                v[j] = vec.get(j);
+            }
+            lp.add_equality(v);
+        }
+        Vec<double> sol(num_cols + m);
+        if (m == 0 || lp.simplex(obj, &sol) != lp::OPT) {
+            return 0;
+        }
+
+        Matrix found, rest;
+        for (size_t i = 0; i < m; ++i) {
+            if (sol[num_cols+i] < 0.5) {
+                found.push_back(move(ineqs[i]));
+            }
+            else {
+                rest.push_back(move(ineqs[i]));
+            }
+        }
+        ineqs = move(rest);
+
+        // Keep only a linearly independent subset of the equalities, using
+        // an integer echelon form to test for dependence:
+        Matrix basis;
+        std::vector<size_t> pivots;
+        auto independent = [&] (const Vector& v) {
+            Vector w = v.copy();
+            for (size_t k = 0; k < basis.size(); ++k) {
+                Value a = basis[k].get(pivots[k]);
+                Value b = w.get(pivots[k]);
+                if (b) {
+                    Value div = gcd(abs(a), abs(b));
+                    w = scaled_addition(w, abs(a) / div,
+                                        basis[k], -sign(a) * b / div);
+                    w.normalize();
+                }
+            }
+            if (w.empty())
+                return false;
+            size_t p = 0;
+            while (!w.get(p))
+                ++p;
+            basis.push_back(move(w));
+            pivots.push_back(p);
+            return true;
+        };
+        Matrix all = move(eqs);
+        eqs.clear();
+        for (auto&& v : all) {
+            if (independent(v)) {
+                eqs.push_back(move(v));
+            }
+        }
+        size_t num_found = 0;
+        for (auto&& v : found) {
+            if (independent(v)) {
+                add_equality(move(v));
+                ++num_found;
+            }
+        }
+        return num_found;
+    }
+
+    size_t System::dimension() const
+    {
+        return num_cols - eqs.size();
+    }
+
+    void System::split_equalities()
+    {
+        for (auto&& vec : eqs) {
+            ineqs.push_back(vec.copy());
+            vec.values *= -1;
+            ineqs.push_back(move(vec));
+        }
+        eqs.clear();
+    }
+
+    int System::find_pivot(size_t index) const
+    {
+        int pivot = -1;
+        for (int i = 0; i < eqs.size(); ++i) {
+            Value a = abs(eqs[i].get(index));
+            if (a && (pivot < 0 || a < abs(eqs[pivot].get(index)))) {
+                pivot = i;
+            }
+        }
+        return pivot;
+    }
+
+    // Exact integer substitution: each row r is replaced by the multiple of
+    // r minus the multiple of the pivot equality e that cancels the column.
+    // The factor on r is positive, so inequalities keep their direction.
+    bool System::substitute(size_t index)
+    {
+        int pivot = find_pivot(index);
+        if (pivot < 0)
+            return false;
+        Vector e = move(eqs[pivot]);
+        eqs.erase(eqs.begin() + pivot);
+        auto reduce = [&e, index] (Matrix& rows) {
+            Matrix r;
+            r.reserve(rows.size());
+            for (auto&& v : rows) {
+                if (v.get(index)) {
+                    v = v.eliminate(e, index);
+                }
+                else {
+                    v.remove(index);
+                }
+                if (!v.empty()) {
+                    r.push_back(move(v));
+                }
+            }
+            rows = move(r);
+        };
+        reduce(ineqs);
+        reduce(eqs);
+        --num_cols;
+        return true;
+    }
+
+    void System::truncate(size_t n)
+    {
+        auto keep = [n] (Matrix& rows) {
+            Matrix r;
+            for (auto&& v : rows) {
+                bool zero = true;
+                for (size_t j = n; j < v.size() && zero; ++j) {
+                    zero = v.get(j) == 0;
+                }
+                if (!zero) {
+                    continue;
+                }
+                Vector w = ValArray(v.values[std::slice(0, n, 1)]);
+                if (!w.empty()) {
+                    r.push_back(move(w));
+                }
+            }
+            rows = move(r);
+        };
+        keep(ineqs);
+        keep(eqs);
+        num_cols = n;
     }
 
     void System::add_inequality(Vector&& vec)
@@ -74,6 +318,11 @@ namespace fm
         for (auto&& vec : ineqs) {
             lp.add_inequality(vec.values);
         }
+        // equalities go last so that the LP row indices of the inequalities
+        // stay aligned with the system:
+        for (auto&& vec : eqs) {
+            lp.add_equality(vec.values);
+        }
         return lp;
     }
 
@@ -132,32 +381,58 @@ namespace fm
         values.swap(r);
     }
 
-    // Inplace elimination of coefficients.
+    // Factors s0 > 0 and s1 such that s0*a + s1*b == 0 (for opposite signs
+    // of a and b), reduced by their gcd.
+    static void elimination_factors(Wide a, Wide b, Wide& s0, Wide& s1)
+    {
+        Wide s = -sign(a*b);
+        a = a < 0 ? -a : a;
+        b = b < 0 ? -b : b;
+        Wide div = gcd(a, b);
+        s0 = b / div;
+        s1 = s * (a / div);
+    }
+
+    // Combine with v such that the i-th coefficient cancels, normalize the
+    // result and drop the i-th component. The combination is computed in
+    // the wider type and only narrowed after dividing by the gcd, so that
+    // intermediate products can not overflow.
     Vector Vector::eliminate(const Vector& v, size_t i) const
     {
-        Value a = get(i);
-        Value b = v.get(i);
-        Value s = -sign(a*b);
-        a = abs(a);
-        b = abs(b);
-        Value div = gcd(a, b);
-        Vector r = scaled_addition(*this, (b / div),
-                                   v, s * (a / div));
-        r.normalize();
-        r.remove(i);
+        Vector r(size() - 1);
+        std::vector<Wide> scratch;
+        eliminate(v, i, r, scratch);
         return r;
     }
 
+    void Vector::eliminate(const Vector& v, size_t i,
+                           Vector& out, std::vector<Wide>& scratch) const
+    {
+        Wide s0, s1;
+        elimination_factors(get(i), v.get(i), s0, s1);
+        size_t n = size();
+        if (scratch.size() < n) {
+            scratch.resize(n);
+        }
+        if (out.size() != n - 1) {
+            out.values.resize(n - 1);
+        }
+        Wide* w = scratch.data();
+        kernel::combine(std::begin(values), s0, std::begin(v.values), s1,
+                        w, n);
+        Wide g = kernel::row_gcd(w, n);
+        if (g == 0) {
+            g = 1;
+        }
+        Value* r = std::begin(out.values);
+        kernel::divide_narrow(w, g, r, i);
+        kernel::divide_narrow(w + i+1, g, r + i, n - i-1);
+    }
+
     // Inplace normalization of coefficients.
     void Vector::normalize()
     {
-        Value div(0);
-        for (const Value& x : values) {
-            div = gcd<Value>(div, abs(x));
-            if (div == 1) {
-                return;
-            }
-        }
+        Value div = kernel::row_gcd(std::begin(values), size());
         if (div > 1) {
             values /= div;
         }
@@ -173,21 +448,135 @@ namespace fm
         return r;
     }
 
+    // class SparseVector
+
+    SparseVector::SparseVector(size_t d)
+        : dim(d)
+    {
+    }
+
+    SparseVector::SparseVector(const Vector& v)
+        : dim(v.size())
+    {
+        for (size_t j = 0; j < dim; ++j) {
+            if (v.get(j)) {
+                index.push_back(j);
+                value.push_back(v.get(j));
+            }
+        }
+    }
+
+    Vector SparseVector::dense() const
+    {
+        Vector r(dim);
+        for (size_t k = 0; k < index.size(); ++k) {
+            r.set(index[k], value[k]);
+        }
+        return r;
+    }
+
+    size_t SparseVector::nnz() const
+    {
+        return index.size();
+    }
+
+    Value SparseVector::get(size_t i) const
+    {
+        auto it = std::lower_bound(index.begin(), index.end(), int(i));
+        if (it == index.end() || *it != i)
+            return 0;
+        return value[it - index.begin()];
+    }
+
+    SparseVector SparseVector::eliminate(const SparseVector& v,
+                                         size_t i) const
+    {
+        SparseVector r;
+        std::vector<Wide> scratch;
+        eliminate(v, i, r, scratch);
+        return r;
+    }
+
+    // Same as Vector::eliminate, by merging the sorted index lists.
+    void SparseVector::eliminate(const SparseVector& v, size_t i,
+                                 SparseVector& out,
+                                 std::vector<Wide>& scratch) const
+    {
+        Wide s0, s1;
+        elimination_factors(get(i), v.get(i), s0, s1);
+        out.dim = dim - 1;
+        out.index.clear();
+        scratch.clear();
+        Wide g = 0;
+        size_t p = 0, q = 0;
+        while (p < nnz() || q < v.nnz()) {
+            int j;
+            Wide x = 0;
+            if (q == v.nnz() || (p < nnz() && index[p] < v.index[q])) {
+                j = index[p];
+                x = s0 * value[p++];
+            }
+            else if (p == nnz() || v.index[q] < index[p]) {
+                j = v.index[q];
+                x = s1 * v.value[q++];
+            }
+            else {
+                j = index[p];
+                x = s0 * value[p++] + s1 * v.value[q++];
+            }
+            if (x && j != i) {
+                out.index.push_back(j < i ? j : j-1);
+                scratch.push_back(x);
+                g = gcd(g, x < 0 ? -x : x);
+            }
+        }
+        out.value.resize(scratch.size());
+        kernel::divide_narrow(scratch.data(), g ? g : 1,
+                              out.value.data(), scratch.size());
+    }
+
+    void SparseVector::normalize()
+    {
+        Value div(0);
+        for (const Value& x : value) {
+            div = gcd<Value>(div, abs(x));
+            if (div == 1) {
+                return;
+            }
+        }
+        if (div > 1) {
+            for (Value& x : value) {
+                x /= div;
+            }
+        }
+    }
+
     // friends & co
 
     Vector scaled_addition(const Vector& v0, Value s0,
                            const Vector& v1, Value s1)
     {
-        Vector r;
-        r.values = la::scaled_addition(v0.values, s0, v1.values, s1);
+        assert_eq_size(v0.size(), v1.size());
+        size_t n = v0.size();
+        std::vector<Wide> w(n);
+        kernel::combine(std::begin(v0.values), s0, std::begin(v1.values), s1,
+                        w.data(), n);
+        Vector r(n);
+        kernel::divide_narrow(w.data(), 1, std::begin(r.values), n);
         return r;
     }
 
+    // Equalities are written as pairs of opposite inequalities, so that the
+    // output can be read by all tools (see System::find_equalities).
     ostream& operator << (ostream& o, const System& s)
     {
         for (auto&& v : s.ineqs) {
             o << v << '\n';
         }
+        for (auto&& v : s.eqs) {
+            o << v << '\n';
+            o << Vector(ValArray(-v.values)) << '\n';
+        }
         return o;
     }
 
@@ -216,6 +605,138 @@ size_t num_elemental_inequalities(size_t num_vars)
 // Return elemental inequalities for a system of num_vars random variables.
 System elemental_inequalities(size_t num_vars)
 {
+    vector<SparseVector> rows = sparse_elemental_inequalities(num_vars);
+    System system(rows.size(), 1<<num_vars);
+    for (auto&& v : rows) {
+        system.add_inequality(v.dense());
+    }
+    return system;
+}
+
+
+// Tables of the elemental inequalities of 3 to 6 variables, generated at
+// compile time by the constexpr functions below. They list the same rows
+// in the same order as the loops in `sparse_elemental_inequalities`.
+
+struct ElementalEntry
+{
+    size_t col;
+    int coef;               // 0 for unused entries
+};
+
+struct ElementalRow
+{
+    ElementalEntry e[4];
+};
+
+constexpr size_t ce_skip_bit(size_t pool, size_t bit)
+{
+    return ((pool & ~((size_t(1) << bit) - 1)) << 1)
+        | (pool & ((size_t(1) << bit) - 1));
+}
+
+// Variables a < b of the p-th pair, in the order of the loops:
+constexpr size_t pair_first(size_t n, size_t p, size_t a=0)
+{
+    return p < n-1-a ? a : pair_first(n, p - (n-1-a), a+1);
+}
+
+constexpr size_t pair_second(size_t n, size_t p, size_t a=0)
+{
+    return p < n-1-a ? a+1+p : pair_second(n, p - (n-1-a), a+1);
+}
+
+// k-th nonzero of H(X_a:X_b|X_K) >= 0:
+constexpr ElementalEntry mutual_entry(size_t A, size_t B, size_t K, size_t k)
+{
+    return k == 0 ? (K ? ElementalEntry{K, -1} : ElementalEntry{0, 0})
+         : k == 1 ? ElementalEntry{A|K, 1}
+         : k == 2 ? ElementalEntry{B|K, 1}
+         :          ElementalEntry{A|B|K, -1};
+}
+
+// k-th nonzero for the i-th subset K of the p-th pair:
+constexpr ElementalEntry pair_entry(size_t n, size_t p, size_t i, size_t k)
+{
+    return mutual_entry(size_t(1) << pair_first(n, p),
+                        size_t(1) << pair_second(n, p),
+                        ce_skip_bit(ce_skip_bit(i, pair_first(n, p)),
+                                    pair_second(n, p)),
+                        k);
+}
+
+// k-th nonzero of H(X_i|X_c) >= 0, where c = ~ {i}:
+constexpr ElementalEntry entropy_entry(size_t all, size_t i, size_t k)
+{
+    return k == 0 ? ElementalEntry{all ^ (size_t(1) << i), -1}
+         : k == 1 ? ElementalEntry{all, 1}
+         :          ElementalEntry{0, 0};
+}
+
+// k-th nonzero of the r-th row:
+constexpr ElementalEntry elemental_entry(size_t n, size_t r, size_t k)
+{
+    return r < n
+        ? entropy_entry((size_t(1) << n) - 1, r, k)
+        : pair_entry(n, (r-n) >> (n-2), (r-n) & ((size_t(1) << (n-2)) - 1), k);
+}
+
+template <size_t... I> struct Indices {};
+
+template <size_t M, size_t... I>
+struct MakeIndices : MakeIndices<M-1, M-1, I...> {};
+
+template <size_t... I>
+struct MakeIndices<0, I...>
+{
+    typedef Indices<I...> type;
+};
+
+template <size_t N, class R = typename MakeIndices<
+    N + N*(N-1)/2 * (size_t(1) << (N-2))>::type>
+struct ElementalTable;
+
+template <size_t N, size_t... R>
+struct ElementalTable<N, Indices<R...>>
+{
+    static constexpr ElementalRow rows[sizeof...(R)] = {
+        {{elemental_entry(N, R, 0), elemental_entry(N, R, 1),
+          elemental_entry(N, R, 2), elemental_entry(N, R, 3)}}...
+    };
+};
+
+template <size_t N, size_t... R>
+constexpr ElementalRow ElementalTable<N, Indices<R...>>::rows[sizeof...(R)];
+
+template <size_t N>
+static vector<SparseVector> table_elemental_inequalities()
+{
+    vector<SparseVector> rows;
+    rows.reserve(std::end(ElementalTable<N>::rows)
+                 - std::begin(ElementalTable<N>::rows));
+    for (auto&& row : ElementalTable<N>::rows) {
+        SparseVector v(size_t(1) << N);
+        for (auto&& e : row.e) {
+            if (e.coef) {
+                v.index.push_back(e.col);
+                v.value.push_back(e.coef);
+            }
+        }
+        rows.push_back(move(v));
+    }
+    return rows;
+}
+
+// Same, only storing the nonzeros (3 or 4 per row).
+vector<SparseVector> sparse_elemental_inequalities(size_t num_vars)
+{
+    switch (num_vars) {
+        case 3: return table_elemental_inequalities<3>();
+        case 4: return table_elemental_inequalities<4>();
+        case 5: return table_elemental_inequalities<5>();
+        case 6: return table_elemental_inequalities<6>();
+    }
+
     // Identify each variable with its index i from I = {0, 1, ..., N-1}.
     // Then entropy is a real valued set function from the power set of
     // indices P = 2**I. The value for the empty set can be defined to be
@@ -235,8 +756,14 @@ System elemental_inequalities(size_t num_vars)
     //  - better integrate with GLPK's 1-based indexing
     size_t nb_cols = dim + 1;
 
-    // Create the system
-    System system = System(nb_lines, nb_cols);
+    vector<SparseVector> rows;
+    rows.reserve(nb_lines);
+
+    // (indices must be added in increasing order)
+    auto add = [] (SparseVector& v, size_t i, Value x) {
+        v.index.push_back(i);
+        v.value.push_back(x);
+    };
 
     // index of the entropy component corresponding to the joint entropy of
     // all variables. NOTE: since the left-most column is not used, the
@@ -248,10 +775,10 @@ System elemental_inequalities(size_t num_vars)
     // the form H(X_i|X_c)>=0 where c = ~ {i}:
     for (size_t i = 0; i < num_vars; ++i) {
         size_t c = all ^ (1 << i);
-        Vector v(nb_cols);
-        v.set(all, 1);
-        v.set(c, -1);
-        system.add_inequality(move(v));
+        SparseVector v(nb_cols);
+        add(v, c, -1);
+        add(v, all, 1);
+        rows.push_back(move(v));
     }
 
     // Add all elemental conditional mutual information positivities, i.e.
@@ -262,19 +789,19 @@ System elemental_inequalities(size_t num_vars)
             size_t B = 1 << b;
             for (size_t i = 0; i < sub_dim; ++i) {
                 size_t K = skip_bit(skip_bit(i, a), b);
-                Vector v(nb_cols);
-                v.set(A|K, 1);
-                v.set(B|K, 1);
-                v.set(A|B|K, -1);
+                SparseVector v(nb_cols);
                 if (K) {
-                    v.set(K, -1);
+                    add(v, K, -1);
                 }
-                system.add_inequality(move(v));
+                add(v, A|K, 1);
+                add(v, B|K, 1);
+                add(v, A|B|K, -1);
+                rows.push_back(move(v));
             }
         }
     }
 
-    return system;
+    return rows;
 }
 
 
@@ -342,6 +869,42 @@ void add_causal_constraints(System& s, size_t nf, size_t ni, size_t links)
 // matrix "methods"
 //----------------------------------------
 
+double fill_ratio(const Matrix& m)
+{
+    size_t num = 0, nnz = 0;
+    for (auto&& v : m) {
+        num += v.size();
+        for (Value x : v.values) {
+            nnz += x != 0;
+        }
+    }
+    return num ? double(nnz) / num : 0;
+}
+
+size_t heap_size(const Matrix& m)
+{
+    size_t bytes = m.capacity() * sizeof(Vector);
+    for (auto&& v : m) {
+        bytes += v.size() * sizeof(Value);
+    }
+    return bytes;
+}
+
+size_t heap_size(const std::vector<SparseVector>& m)
+{
+    size_t bytes = m.capacity() * sizeof(SparseVector);
+    for (auto&& v : m) {
+        bytes += v.index.capacity() * sizeof(int)
+            + v.value.capacity() * sizeof(Value);
+    }
+    return bytes;
+}
+
+size_t heap_size(const System& s)
+{
+    return heap_size(s.ineqs) + heap_size(s.eqs);
+}
+
 int get_num_cols(const Matrix& matrix)
 {
     if (matrix.empty())
@@ -405,6 +968,8 @@ Matrix parse_matrix(const vector<string>& lines)
     for (auto&& v : la::parse_matrix<Value>(lines)) {
         m.push_back(move(v));
     }
+    // (the input lines are dropped after parsing)
+    memory::record(memory::IO, 0);
     return m;
 }
 
@@ -414,28 +979,244 @@ Matrix parse_matrix(const vector<string>& lines)
 //----------------------------------------
 
 
-void solve_to::run(const solve_to::Callback& cb)
+// Origin sets of the given number of input rows, one row each:
+static vector<Origin> input_origins(size_t num)
+{
+    vector<Origin> r(num, Origin(num));
+    for (size_t i = 0; i < num; ++i) {
+        r[i].set(i);
+    }
+    return r;
+}
+
+// The origin sets are looked up by the coefficients of the rows after an
+// operation that removes rows from a system without changing the others:
+typedef std::map<vector<Value>, Origin> OriginMap;
+
+static OriginMap origin_map(const Matrix& rows, const vector<Origin>& origins)
+{
+    OriginMap map;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        auto&& v = rows[i].values;
+        map.insert({vector<Value>(std::begin(v), std::end(v)), origins[i]});
+    }
+    return map;
+}
+
+static vector<Origin> find_origins(const Matrix& rows, const OriginMap& map)
+{
+    vector<Origin> r;
+    r.reserve(rows.size());
+    for (auto&& row : rows) {
+        auto&& v = row.values;
+        auto it = map.find(vector<Value>(std::begin(v), std::end(v)));
+        _assert(it != map.end(), std::logic_error, "row without origin");
+        r.push_back(it->second);
+    }
+    return r;
+}
+
+static size_t heap_size(const vector<Origin>& origins)
+{
+    size_t bytes = origins.capacity() * sizeof(Origin);
+    for (auto&& o : origins) {
+        bytes += o.num_blocks() * sizeof(Origin::block_type);
+    }
+    return bytes;
+}
+
+bool MinimizePolicy::enabled() const
+{
+    return growth > 0 || max_pn > 0 || redundancy > 0;
+}
+
+// Returns the callback policy behind a dynamic (pointer) or static hook:
+template <class T> static const T& callback(const P<T>& cb) { return *cb; }
+template <class T> static const T& callback(const T& cb) { return cb; }
+
+void solve_to::run()
+{
+    run_with(Quiet());
+}
+
+void solve_to::run(const Callback& cb)
+{
+    run_with(cb);
+}
+
+template <class CB>
+void solve_to::run_with(const CB& cb)
 {
     auto sg = cb.enter(this);
-    for (int step = 0; sys.num_cols > to; ++step) {
+    bool resumed = state.step > 0;
+    if (!resumed) {
+        state.num_minimized = sys.ineqs.size();
+    }
+    size_t& num_minimized = state.num_minimized;
+    size_t& num_tested = state.num_tested;
+    double& rate = state.rate;
+
+    bool reduce = policy.reduce;
+    if (reduce && !resumed) {
+        cb.found_equalities(0, sys.find_implicit_equalities());
+    }
+    memory::start_period();
+
+    // Origin sets are tracked across the steps (they are not saved in
+    // checkpoints, a resumed run starts over with the current rows):
+    vector<Origin> origins;
+    if (schedule == eliminate::ORIGIN) {
+        origins = input_origins(sys.ineqs.size());
+    }
+    bool track = !origins.empty();
+
+    for (int step = state.step; sys.num_cols > to; ++step) {
         auto sg = cb.start_step(step);
-        int best_index = to;
-        int best_rank = get_rank(to);
-        for (int i = to+1; i < sys.num_cols; ++i) {
-            int rank = get_rank(i);
-            if (rank < best_rank) {
-                best_index = i;
-                best_rank = rank;
+        if (cancel && cancel->poll()) {
+            break;
+        }
+        // (rows removed from outside, e.g. by a minimize on key press)
+        if (track && origins.size() != sys.ineqs.size()) {
+            origins = input_origins(sys.ineqs.size());
+        }
+        int index = best_index();
+        int pos, neg;
+        count_signs(index, pos, neg);
+
+        const char* reason = nullptr;
+        if (!policy.enabled() || step == 0) {
+            // nothing to do
+        }
+        else if (policy.growth > 0 &&
+                 sys.ineqs.size() > policy.growth * num_minimized) {
+            reason = "growth";
+        }
+        else if (policy.max_pn > 0 && long(pos)*neg > policy.max_pn) {
+            reason = "p*n";
+        }
+        else if (policy.redundancy > 0 &&
+                 (rate < 0 || rate >= policy.redundancy)) {
+            reason = "redundancy";
+        }
+        else if (policy.redundancy > 0 && policy.probe > 0 &&
+                 step % policy.probe == 0) {
+            // re-measure a rate that was below the threshold
+            reason = "probe";
+        }
+
+        if (reason) {
+            OriginMap map;
+            if (track) {
+                map = origin_map(sys.ineqs, origins);
             }
+            if (reduce) {
+                size_t num = sys.find_implicit_equalities();
+                // (rows may be irredundant only due to the moved rows)
+                if (num > 0) {
+                    num_tested = 0;
+                }
+                cb.found_equalities(step, num);
+            }
+            size_t first = policy.partial ? num_tested : 0;
+            size_t num_orig = sys.ineqs.size();
+            auto mcb = cb.start_minimize(step, reason);
+            minimize{sys, minimize::REVERSE, nullptr, first, nullptr, cancel}
+                .run_with(callback(mcb));
+            num_minimized = sys.ineqs.size();
+            num_tested = num_minimized;
+            if (track) {
+                origins = find_origins(sys.ineqs, map);
+            }
+            rate = num_orig > first
+                ? double(num_orig - num_minimized) / (num_orig - first)
+                : 0;
+            index = best_index();
+            count_signs(index, pos, neg);
+        }
+
+        if (cancel && cancel->cancelled()) {
+            break;
+        }
+
+        // An irredundant row stays irredundant in the projection. FM puts
+        // the rows without the column first (in their order), so the
+        // tested ones among them stay in front. Substitution keeps the
+        // order and never drops an irredundant row:
+        if (sys.find_pivot(index) < 0) {
+            size_t num = 0;
+            for (size_t i = 0; i < num_tested; ++i) {
+                num += sys.ineqs[i].get(index) == 0;
+            }
+            num_tested = num;
+        }
+        auto ecb = cb.start_eliminate(index);
+        eliminate{sys, index, schedule, purge, budget, cancel,
+                  track ? &origins : nullptr}
+            .run_with(callback(ecb));
+        if (cancel && cancel->cancelled()) {
+            break;
+        }
+
+        memory::record(memory::SYSTEM, heap_size(sys));
+        cb.finished_step(step, memory::start_period());
+
+        state.step = step + 1;
+        state.order.push_back(index);
+        if (checkpoint) {
+            checkpoint->save(sys, state);
+        }
+    }
+    if (checkpoint) {
+        checkpoint->wait();
+    }
+    // (rows of an interrupted step are valid, but may be incomplete)
+    if (cancel && cancel->cancelled()) {
+        sys.truncate(to);
+    }
+}
+
+// Return the column with the lowest rank among the columns to be
+// eliminated. Columns that can be substituted using an equality are always
+// preferred.
+int solve_to::best_index() const
+{
+    for (int i = to; i < sys.num_cols; ++i) {
+        if (sys.find_pivot(i) >= 0) {
+            return i;
+        }
+    }
+    // count the signs of all columns in one pass over the rows:
+    std::vector<int> pos(sys.num_cols), neg(sys.num_cols);
+    for (auto&& vec : sys.ineqs) {
+        kernel::count_signs(std::begin(vec.values), vec.size(),
+                            pos.data(), neg.data());
+    }
+    auto get_rank = [&pos, &neg] (int i) {
+        return (pos[i]*neg[i]) - (pos[i]+neg[i]);
+    };
+    int best_index = to;
+    int best_rank = get_rank(to);
+    for (int i = to+1; i < sys.num_cols; ++i) {
+        int rank = get_rank(i);
+        if (rank < best_rank) {
+            best_index = i;
+            best_rank = rank;
         }
-        eliminate{sys, best_index}.run(*cb.start_eliminate(best_index));
     }
+    return best_index;
 }
 
 int solve_to::get_rank(int index) const
 {
-    int pos = 0;
-    int neg = 0;
+    int pos, neg;
+    count_signs(index, pos, neg);
+    return (pos*neg) - (pos+neg);
+}
+
+void solve_to::count_signs(int index, int& pos, int& neg) const
+{
+    pos = 0;
+    neg = 0;
     for (auto&& vec : sys.ineqs) {
         Value val = vec.get(index);
         if (val > 0) {
@@ -445,7 +1226,6 @@ int solve_to::get_rank(int index) const
             ++neg;
         }
     }
-    return (pos*neg) - (pos+neg);
 }
 
 EliminatePtr solve_to::Callback::start_eliminate(int index) const
@@ -453,16 +1233,257 @@ EliminatePtr solve_to::Callback::start_eliminate(int index) const
     return P<eliminate::Callback>(new eliminate::Callback());
 }
 
-void eliminate::run(const eliminate::Callback& cb)
+MinimizePtr solve_to::Callback::start_minimize(int step,
+                                               const char* reason) const
+{
+    return P<minimize::Callback>(new minimize::Callback());
+}
+
+// Rows are combined in sparse form if at most this fraction of the
+// coefficients is nonzero:
+static const double max_sparse_fill = 0.25;
+
+// Number of candidates between two progress reports:
+static const int progress_interval = 512;
+
+// Only the sort key and the indices of the pair are kept for each
+// candidate, the combined vector is recomputed when the candidate is
+// checked. Candidates with equal rows have equal keys and hashes, so they
+// end up next to each other.
+struct Candidate
+{
+    long key;
+    uint64_t hash;          // of the normalized combined row
+    int p, n;
+
+    bool operator < (const Candidate& c) const
+    {
+        return std::tie(key, hash, p, n) < std::tie(c.key, c.hash, c.p, c.n);
+    }
+};
+
+// Sorted list of candidates. Once the list exceeds the memory budget, it
+// is written to a temporary file as a sorted run, and the runs are merged
+// back when iterating. This way a step with a huge p*n only costs disk
+// space and time rather than memory.
+class CandidateQueue
+{
+public:
+    explicit CandidateQueue(size_t budget)
+        : max_size(budget ? std::max<size_t>(budget / sizeof(Candidate), 1)
+                          : size_t(-1))
+    {
+    }
+
+    ~CandidateQueue()
+    {
+        for (FILE* f : runs) {
+            fclose(f);
+        }
+    }
+
+    void push(const Candidate& c)
+    {
+        if (buf.size() >= max_size) {
+            spill();
+        }
+        buf.push_back(c);
+    }
+
+    size_t num_runs() const
+    {
+        return runs.size();
+    }
+
+    size_t heap_size() const
+    {
+        return buf.capacity() * sizeof(Candidate);
+    }
+
+    // Call f for all candidates in sorted order, until it returns false:
+    template <class F>
+    void for_each(F f)
+    {
+        if (runs.empty()) {
+            std::sort(buf.begin(), buf.end());
+            for (auto&& c : buf) {
+                if (!f(c)) {
+                    return;
+                }
+            }
+            return;
+        }
+        spill();
+        std::vector<Candidate>().swap(buf);
+
+        // k-way merge, reading the runs in chunks that together fit into
+        // the budget:
+        size_t chunk = std::max<size_t>(max_size / runs.size(), 64);
+        std::vector<std::vector<Candidate>> chunks(runs.size());
+        std::vector<size_t> pos(runs.size());
+        auto fill = [&] (size_t r) {
+            chunks[r].resize(chunk);
+            chunks[r].resize(fread(chunks[r].data(), sizeof(Candidate),
+                                   chunk, runs[r]));
+            pos[r] = 0;
+            return !chunks[r].empty();
+        };
+        typedef std::pair<Candidate, size_t> Head;
+        auto later = [] (const Head& a, const Head& b) {
+            return b.first < a.first;
+        };
+        std::priority_queue<Head, std::vector<Head>, decltype(later)>
+            heads(later);
+        for (size_t r = 0; r < runs.size(); ++r) {
+            rewind(runs[r]);
+            if (fill(r)) {
+                heads.push({chunks[r][0], r});
+            }
+        }
+        memory::record(memory::CANDIDATES,
+                       runs.size() * chunk * sizeof(Candidate));
+        while (!heads.empty()) {
+            Head h = heads.top();
+            heads.pop();
+            if (!f(h.first)) {
+                return;
+            }
+            size_t r = h.second;
+            if (++pos[r] < chunks[r].size() || fill(r)) {
+                heads.push({chunks[r][pos[r]], r});
+            }
+        }
+    }
+
+private:
+    size_t max_size;
+    std::vector<Candidate> buf;
+    std::vector<FILE*> runs;
+
+    void spill()
+    {
+        std::sort(buf.begin(), buf.end());
+        FILE* f = std::tmpfile();
+        if (!f) {
+            throw std::runtime_error(
+                    "Cannot create temporary file for candidates.");
+        }
+        runs.push_back(f);
+        if (fwrite(buf.data(), sizeof(Candidate), buf.size(), f)
+                != buf.size()) {
+            throw std::runtime_error(
+                    "Cannot write candidates to temporary file.");
+        }
+        buf.clear();
+    }
+};
+
+// Compute the sort key for the given schedule and the hash of the nonzero
+// coefficients (x[k] at column col[k], or at column k if col is null):
+static void describe(Candidate& c, eliminate::Schedule schedule,
+                     const Value* x, size_t n, const int* col)
+{
+    c.key = 0;
+    c.hash = 14695981039346656037ull;   // FNV-1a
+    for (size_t k = 0; k < n; ++k) {
+        if (x[k] == 0) {
+            continue;
+        }
+        c.key += schedule == eliminate::SPARSEST ? 1 : abs(x[k]);
+        c.hash = (c.hash ^ uint64_t(col ? col[k] : k)) * 1099511628211ull;
+        c.hash = (c.hash ^ uint64_t(x[k])) * 1099511628211ull;
+    }
+}
+
+// Rows padded with zeros to the width of a fixed width kernel, in one
+// block aligned for it (see kernels.h):
+class FixedRows
+{
+public:
+    FixedRows(size_t num, size_t width)
+        : width(width)
+        , buf(num * width + kernel::fixed_align / sizeof(Value))
+    {
+        void* p = buf.data();
+        size_t space = buf.size() * sizeof(Value);
+        base = (Value*) std::align(kernel::fixed_align,
+                                   num * width * sizeof(Value), p, space);
+    }
+
+    FixedRows(const Matrix& rows, size_t width)
+        : FixedRows(width ? rows.size() : 0, width)
+    {
+        for (size_t i = 0; i < rows.size() && width; ++i) {
+            auto&& v = rows[i].values;
+            std::copy(std::begin(v), std::end(v), (*this)[i]);
+        }
+    }
+
+    Value* operator [] (size_t i) { return base + i * width; }
+    const Value* operator [] (size_t i) const { return base + i * width; }
+
+    size_t heap_size() const
+    {
+        return buf.capacity() * sizeof(Value);
+    }
+
+private:
+    size_t width;
+    std::vector<Value> buf;
+    Value* base;
+};
+
+void eliminate::run()
+{
+    run_with(Quiet());
+}
+
+void eliminate::run(const Callback& cb)
+{
+    run_with(cb);
+}
+
+template <class CB>
+void eliminate::run_with(const CB& cb)
 {
     auto _enter = cb.enter(this);
 
+    // Without origin sets from earlier steps, every row is an input row:
+    vector<Origin> own;
+    vector<Origin>* org = origins;
+    if (schedule == ORIGIN && !org) {
+        own = input_origins(sys.ineqs.size());
+        org = &own;
+    }
+
+    // Exact substitution does not increase the number of rows:
+    int pivot = sys.find_pivot(index);
+    if (pivot >= 0) {
+        auto _subst = cb.start_substitute(sys.ineqs.size(), sys.eqs.size());
+        if (org) {
+            // (the rows keep their origins, except those that vanish)
+            vector<Origin> kept;
+            for (size_t i = 0; i < sys.ineqs.size(); ++i) {
+                const Vector& v = sys.ineqs[i];
+                if (!v.get(index) ||
+                        !v.eliminate(sys.eqs[pivot], index).empty()) {
+                    kept.push_back(std::move((*org)[i]));
+                }
+            }
+            *org = std::move(kept);
+        }
+        sys.substitute(index);
+        return;
+    }
+
     System s = sys.copy();
 
     // Partition inequality constraints into (zero, positive, negative)
     // coefficient for the given index.
     Matrix zero, pos, neg;
-    for (auto&& vec : s.ineqs) {
+    vector<Origin> ozero, opos, oneg;
+    for (size_t i = 0; i < s.ineqs.size(); ++i) {
+        auto&& vec = s.ineqs[i];
         Value val = vec.get(index);
         if (val == 0) {
             vec.remove(index);
@@ -474,6 +1495,14 @@ void eliminate::run(const eliminate::Callback& cb)
         if (val < 0) {
             neg.push_back(move(vec));
         }
+        if (org) {
+            auto&& o = (*org)[i];
+            (val == 0 ? ozero : val > 0 ? opos : oneg).push_back(std::move(o));
+        }
+    }
+
+    for (auto&& vec : s.eqs) {
+        vec.remove(index);
     }
 
     s.ineqs = move(zero);
@@ -481,36 +1510,405 @@ void eliminate::run(const eliminate::Callback& cb)
 
     auto _append = cb.start_append(sys.ineqs.size(), pos.size(), neg.size());
 
+    // Rows of at most 64 columns are combined by the kernel for their
+    // width, wider sparse rows in sparse form. The dense copies are then
+    // released to save memory:
+    size_t width = kernel::fixed_width(sys.num_cols);
+    auto fixed = kernel::fixed_eliminate(width);
+    bool sparse = !width && fill_ratio(sys.ineqs) < max_sparse_fill;
+    FixedRows fpos(pos, width), fneg(neg, width), fcand(1, width);
+    size_t num_pos = pos.size();
+    size_t num_neg = neg.size();
+    if (width) {
+        Matrix().swap(pos);
+        Matrix().swap(neg);
+    }
+    std::vector<SparseVector> spos, sneg;
+    if (sparse) {
+        for (auto&& v : pos) {
+            spos.emplace_back(v);
+        }
+        for (auto&& v : neg) {
+            sneg.emplace_back(v);
+        }
+        Matrix().swap(pos);
+        Matrix().swap(neg);
+    }
+    size_t total = num_pos * num_neg;
+
     Problem lp = s.problem();
-    int i = 0;
-    for (auto&& p : pos) {
-        for (auto&& n : neg) {
-            auto _check = cb.start_check(i++);
-            Vector v = p.eliminate(n, index);
-            if (!lp.is_redundant(v.values)) {
-                lp.add_inequality(v.values);
-                s.add_inequality(move(v));
+    size_t num_zero = s.ineqs.size();
+    size_t num_accepted = 0;
+    size_t i = 0;
+    // (sampled at progress reports, before purging and at the end)
+    auto account = [&] {
+        memory::record(memory::SYSTEM, heap_size(sys) + heap_size(s)
+                       + heap_size(pos) + heap_size(neg)
+                       + heap_size(spos) + heap_size(sneg)
+                       + fpos.heap_size() + fneg.heap_size()
+                       + heap_size(ozero) + heap_size(opos)
+                       + heap_size(oneg));
+        memory::record(memory::LP, lp.heap_size());
+    };
+    // (the origins of the rows in s are collected in ozero)
+    auto added = [&] (size_t ip, size_t in) {
+        if (org) {
+            ozero.push_back(opos[ip] | oneg[in]);
+        }
+        if (purge && ++num_accepted % purge == 0) {
+            account();
+            OriginMap map;
+            if (org) {
+                map = origin_map(s.ineqs, ozero);
+            }
+            minimize{s, minimize::REVERSE, nullptr, num_zero}.run();
+            if (org) {
+                ozero = find_origins(s.ineqs, map);
+            }
+            lp = s.problem();
+        }
+    };
+    // Candidates are combined into these buffers, which are reused for all
+    // pairs. Only accepted candidates are copied into the system:
+    auto stop = [this] {
+        return cancel && cancel->cancelled();
+    };
+    // In sorted order, a candidate that equals the previous one (`dup`)
+    // is skipped without solving an LP. The checked candidate becomes the
+    // previous one by swapping the buffers:
+    Vector cand(s.num_cols), prev(s.num_cols);
+    SparseVector scand, sprev;
+    std::vector<Wide> scratch;
+    auto combine = [&] (size_t ip, size_t in) {
+        if (fixed) {
+            fixed(fpos[ip], fneg[in], index, fcand[0]);
+            std::copy(fcand[0], fcand[0] + s.num_cols,
+                      std::begin(cand.values));
+        }
+        else {
+            pos[ip].eliminate(neg[in], index, cand, scratch);
+        }
+    };
+    auto check = [&] (size_t ip, size_t in, bool dup) {
+        if (++i % progress_interval == 0) {
+            account();
+            cb.progress(i, total);
+        }
+        if (cancel) {
+            cancel->poll();
+        }
+        if (!sparse) {
+            combine(ip, in);
+            if (dup && cand == prev) {
+                return;
+            }
+            std::swap(cand, prev);
+            if (!lp.is_redundant(prev.values)) {
+                lp.add_inequality(prev.values);
+                s.add_inequality(prev.copy());
+                added(ip, in);
+            }
+            return;
+        }
+        spos[ip].eliminate(sneg[in], index, scand, scratch);
+        if (dup && scand.index == sprev.index && scand.value == sprev.value) {
+            return;
+        }
+        std::swap(scand, sprev);
+        if (lp.is_redundant(sprev.index, sprev.value))
+            return;
+        lp.add_inequality(sprev.index, sprev.value);
+        s.add_inequality(sprev.dense());
+        added(ip, in);
+    };
+
+    if (schedule == POS_MAJOR) {
+        for (size_t ip = 0; ip < num_pos; ++ip) {
+            for (size_t in = 0; in < num_neg && !stop(); ++in) {
+                check(ip, in, false);
+            }
+        }
+    }
+    else {
+        CandidateQueue candidates(budget);
+        for (size_t ip = 0; ip < num_pos; ++ip) {
+            for (int in = 0; in < num_neg; ++in) {
+                Candidate c;
+                if (sparse) {
+                    spos[ip].eliminate(sneg[in], index, scand, scratch);
+                    describe(c, schedule, scand.value.data(), scand.nnz(),
+                             scand.index.data());
+                }
+                else {
+                    combine(ip, in);
+                    describe(c, schedule, std::begin(cand.values),
+                             cand.size(), nullptr);
+                }
+                if (schedule == ORIGIN) {
+                    c.key = (opos[ip] | oneg[in]).count();
+                }
+                c.p = ip;
+                c.n = in;
+                candidates.push(c);
             }
         }
+        memory::record(memory::CANDIDATES, candidates.heap_size());
+        Candidate last = {-1};
+        candidates.for_each([&] (const Candidate& c) {
+            check(c.p, c.n, c.key == last.key && c.hash == last.hash);
+            last = c;
+            return !stop();
+        });
     }
 
+    account();
+    memory::record(memory::CANDIDATES, 0);
     sys = move(s);
+    if (org) {
+        *org = std::move(ozero);
+    }
 }
 
-void minimize::run(const minimize::Callback& cb)
+static const char* schedule_names[] = {
+    "pos-major", "sparsest", "norm", "origin",
+};
+
+eliminate::Schedule parse_schedule(const string& name)
+{
+    for (int i = 0; i <= eliminate::ORIGIN; ++i) {
+        if (name == schedule_names[i]) {
+            return eliminate::Schedule(i);
+        }
+    }
+    throw std::invalid_argument("Unknown candidate schedule: " + name);
+}
+
+const char* schedule_name(eliminate::Schedule schedule)
+{
+    return schedule_names[schedule];
+}
+
+// Sort rows back into their original order, given by their original
+// indices `orig`.
+static void restore_order(Matrix& m, const std::vector<size_t>& orig)
+{
+    std::vector<size_t> idx(orig.size());
+    for (size_t i = 0; i < idx.size(); ++i) {
+        idx[i] = i;
+    }
+    std::sort(idx.begin(), idx.end(), [&orig] (size_t a, size_t b) {
+        return orig[a] < orig[b];
+    });
+    Matrix rows;
+    rows.reserve(idx.size());
+    for (size_t i : idx) {
+        rows.push_back(move(m[i]));
+    }
+    m = move(rows);
+}
+
+void minimize::run()
+{
+    run_with(Quiet());
+}
+
+void minimize::run(const Callback& cb)
+{
+    run_with(cb);
+}
+
+template <class CB>
+void minimize::run_with(const CB& cb)
 {
     auto sg = cb.enter(this);
+    if (group && !group->gens.empty() && first == 0) {
+        run_orbits(cb);
+        return;
+    }
+
+    // Arrange the rows such that the first row to be tested comes last and
+    // then proceed from last to first. This way the LP row indices of the
+    // untested rows stay aligned with the system.
+    std::vector<size_t> seq = test_order();
+    std::vector<size_t> orig;
+    Matrix rows;
+    orig.reserve(sys.ineqs.size());
+    rows.reserve(sys.ineqs.size());
+    for (size_t i = 0; i < first; ++i) {
+        orig.push_back(i);
+        rows.push_back(move(sys.ineqs[i]));
+    }
+    for (size_t k = seq.size(); k-- > 0; ) {
+        orig.push_back(seq[k]);
+        rows.push_back(move(sys.ineqs[seq[k]]));
+    }
+    sys.ineqs = move(rows);
+
     fm::Problem lp = sys.problem();
-    for (int i = sys.ineqs.size()-1; i >= 0; --i) {
+    memory::record(memory::SYSTEM, heap_size(sys));
+    memory::record(memory::LP, lp.heap_size());
+    for (int i = sys.ineqs.size()-1; i >= int(first); --i) {
+        if (cancel && cancel->poll()) {
+            break;
+        }
         auto sg = cb.start_round(i);
         lp.del_row(i);
         if (lp.is_redundant(sys.ineqs[i].values)) {
             sys.ineqs.erase(sys.ineqs.begin() + i);
+            orig.erase(orig.begin() + i);
         }
         else {
             lp.add_inequality(sys.ineqs[i].values);
+            cb.accepted(sys.ineqs[i]);
+        }
+    }
+
+    restore_order(sys.ineqs, orig);
+}
+
+// Remove whole row orbits at once. The system must be invariant under the
+// group: if the representative of an orbit is implied by the rows outside
+// of the orbit, then so are all of its images. The converse (an orbit that
+// is not implied by the rows outside contains only facets) only holds if
+// no inequality is tight on the whole cone, so the implicit equalities are
+// moved into the equality block first. They form an invariant set of rows,
+// the remaining rows stay closed under the group.
+template <class CB>
+void minimize::run_orbits(const CB& cb)
+{
+    sys.find_implicit_equalities();
+    std::vector<Orbit> orbits = row_orbits(sys.ineqs, *group);
+
+    // Test the orbits in the order of their representatives, again placing
+    // the first orbit to be tested last:
+    std::vector<size_t> seq = test_order();
+    std::vector<size_t> rank(sys.ineqs.size());
+    for (size_t k = 0; k < seq.size(); ++k) {
+        rank[seq[k]] = k;
+    }
+    std::sort(orbits.begin(), orbits.end(),
+              [&rank] (const Orbit& a, const Orbit& b) {
+                  return rank[a[0]] > rank[b[0]];
+              });
+
+    std::vector<size_t> orig;
+    std::vector<size_t> start;
+    Matrix rows;
+    orig.reserve(sys.ineqs.size());
+    rows.reserve(sys.ineqs.size());
+    for (auto&& orbit : orbits) {
+        start.push_back(rows.size());
+        for (size_t i : orbit) {
+            orig.push_back(i);
+            rows.push_back(move(sys.ineqs[i]));
+        }
+    }
+    sys.ineqs = move(rows);
+
+    fm::Problem lp = sys.problem();
+    memory::record(memory::SYSTEM, heap_size(sys));
+    memory::record(memory::LP, lp.heap_size());
+    for (int k = orbits.size()-1; k >= 0; --k) {
+        if (cancel && cancel->poll()) {
+            break;
         }
+        size_t b = start[k];
+        size_t e = b + orbits[k].size();
+        auto sg = cb.start_round(b);
+        lp.del_rows(b, e-b);
+        if (lp.is_redundant(sys.ineqs[b].values)) {
+            sys.ineqs.erase(sys.ineqs.begin() + b, sys.ineqs.begin() + e);
+            orig.erase(orig.begin() + b, orig.begin() + e);
+        }
+        else {
+            for (size_t i = b; i < e; ++i) {
+                lp.add_inequality(sys.ineqs[i].values);
+                cb.accepted(sys.ineqs[i]);
+            }
+        }
+    }
+
+    restore_order(sys.ineqs, orig);
+}
+
+// Return the row indices in the order in which they should be tested.
+std::vector<size_t> minimize::test_order() const
+{
+    size_t num = sys.ineqs.size();
+    std::vector<size_t> seq(num > first ? num-first : 0);
+    for (size_t i = 0; i < seq.size(); ++i) {
+        seq[i] = num-1-i;
+    }
+
+    // use stable sorts to fall back to reverse order for equal keys
+    auto sort_by = [&seq] (const std::vector<Value>& key) {
+        std::stable_sort(seq.begin(), seq.end(), [&key] (size_t a, size_t b) {
+            return key[a] > key[b];
+        });
+    };
+
+    std::vector<Value> key(num);
+    switch (order) {
+    case REVERSE:
+        break;
+    case DENSEST:
+        for (size_t i = 0; i < num; ++i) {
+            for (Value x : sys.ineqs[i].values) {
+                key[i] += x != 0;
+            }
+        }
+        sort_by(key);
+        break;
+    case LARGEST:
+        for (size_t i = 0; i < num; ++i) {
+            for (Value x : sys.ineqs[i].values) {
+                key[i] = std::max<Value>(key[i], abs(x));
+            }
+        }
+        sort_by(key);
+        break;
+    case RANDOM: {
+        std::random_device rd;
+        std::default_random_engine random_engine(rd());
+        std::shuffle(seq.begin(), seq.end(), random_engine);
+        break;
     }
+    case LEARNED:
+        if (learned) {
+            // (looked up in a sorted set, the learned rows can be many)
+            typedef std::vector<Value> Row;
+            std::set<Row> rows;
+            for (auto&& w : *learned) {
+                rows.insert(Row(std::begin(w.values), std::end(w.values)));
+            }
+            for (size_t i = 0; i < num; ++i) {
+                auto&& v = sys.ineqs[i].values;
+                key[i] = rows.count(Row(std::begin(v), std::end(v)));
+            }
+        }
+        sort_by(key);
+        break;
+    }
+    return seq;
+}
+
+static const char* order_names[] = {
+    "reverse", "densest", "largest", "random", "learned",
+};
+
+minimize::Order parse_order(const string& name)
+{
+    for (int i = 0; i <= minimize::LEARNED; ++i) {
+        if (name == order_names[i]) {
+            return minimize::Order(i);
+        }
+    }
+    throw std::invalid_argument("Unknown row order: " + name);
+}
+
+const char* order_name(minimize::Order order)
+{
+    return order_names[order];
 }
 
 
@@ -527,6 +1925,16 @@ IO::IO(std::ostream* o, InputPtr i)
     }
 }
 
+bool RateLimit::operator()()
+{
+    boost::timer::nanosecond_type now = timer.elapsed().wall;
+    if (now < next) {
+        return false;
+    }
+    next = now + interval;
+    return true;
+}
+
 // SolveTo
 
 SG SolveToStatusOutput::enter(solve_to* ctx) const
@@ -543,8 +1951,8 @@ SG SolveToStatusOutput::start_step(int step) const
         if (c == 'm') {
             minimize{*sys}.run(MinimizeStatusOutput(*this));
         }
-        if (c == 'c') {
-            // TODO: cancel + output current progress
+        if (c == 'c' && cancel) {
+            cancel->cancel("key");
         }
     }
     return SG();
@@ -555,6 +1963,22 @@ EliminatePtr SolveToStatusOutput::start_eliminate(int index) const
     return P<eliminate::Callback>(new EliminateStatusOutput(*this));
 }
 
+MinimizePtr SolveToStatusOutput::start_minimize(int step,
+                                                const char* reason) const
+{
+    return P<minimize::Callback>(new MinimizeStatusOutput(*this));
+}
+
+SG SolveToStatusOutput::found_equalities(int step, int num) const
+{
+    terminal::clear_current_line(*out);
+    *out << "Implicit equalities: " << num
+        << " (total " << sys->eqs.size()
+        << ", dimension " << sys->dimension() << ")"
+        << endl;
+    return SG();
+}
+
 SolveToStatusOutput::~SolveToStatusOutput()
 {
     *out << endl;
@@ -570,11 +1994,38 @@ SG EliminateStatusOutput::enter(eliminate* ctx) const
 
 SG EliminateStatusOutput::start_append(int z, int p, int n) const
 {
+    this->z = z;
+    this->p = p;
+    this->n = n;
     terminal::clear_current_line(*out);
     *out << "   i = " << setw(3) << sys->num_cols
         << ",  z = " << setw(4) << z
         << ",  p+n = " << setw(3) << p+n
-        << "   p*n = " << setw(4) << p*n
+        << "   p*n = " << setw(4) << p*n;
+    if (show_memory) {
+        *out << ",  mem = " << memory::format(memory::current_total())
+            << " (rss " << memory::format(memory::current_rss()) << ")";
+    }
+    *out << std::flush;
+    return SG();
+}
+
+void EliminateStatusOutput::progress(size_t checked, size_t total) const
+{
+    if (rate()) {
+        start_append(z, p, n);
+        *out << "   (" << setw(3) << checked * 100 / total << "%)"
+            << std::flush;
+    }
+}
+
+SG EliminateStatusOutput::start_substitute(int z, int e) const
+{
+    terminal::clear_current_line(*out);
+    *out << "   i = " << setw(3) << sys->num_cols
+        << ",  z = " << setw(4) << z
+        << ",  e = " << setw(3) << e
+        << "   (substitute)"
         << std::flush;
     return SG();
 }
@@ -590,23 +2041,28 @@ SG MinimizeStatusOutput::enter(minimize* ctx) const
 {
     sys = &ctx->sys;
     num_orig = ctx->sys.ineqs.size();
+    order = ctx->order;
+    timer.start();
     return SG();
 }
 
 SG MinimizeStatusOutput::start_round(int index) const
 {
-    *out << "Minimizing: " << num_orig << " -> " << sys->ineqs.size()
-        << "  (i=" << index << ")"
-        << std::flush;
-    return SG(nullptr, [this] (void*) {
+    if (rate()) {
         terminal::clear_current_line(*out);
-    });
+        *out << "Minimizing: " << num_orig << " -> " << sys->ineqs.size()
+            << "  (i=" << index << ")"
+            << std::flush;
+    }
+    return SG();
 }
 
 MinimizeStatusOutput::~MinimizeStatusOutput()
 {
+    terminal::clear_current_line(*out);
     *out << "Minimizing: " << num_orig << " -> " << sys->ineqs.size()
-        << " (DONE)"
+        << " (DONE, order=" << order_name(order)
+        << ", " << timer.format(3, "%ws") << ")"
         << endl;
 }
 
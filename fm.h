@@ -6,17 +6,30 @@
 
 # include <iostream>
 # include <memory>      // shared_ptr
+# include <string>
 # include <valarray>
 # include <vector>
 
+# include <boost/dynamic_bitset.hpp>
+# include <boost/timer/timer.hpp>
+
 # include "lp.h"
 # include "linalg.h"
+# include "memory.h"
+# include "number.h"
+
+// Coefficient type. Can be chosen at build time, e.g. a narrow type for
+// compact storage with `make CFLAGS+=-DFM_VALUE=short`.
+# ifndef FM_VALUE
+#  define FM_VALUE int
+# endif
 
 # define EMPTY(type) { return type(); }
 
 
 // External
 namespace terminal { class Input; }
+namespace fm { struct Group; class Checkpoint; class CancelToken; }
 
 
 // Local
@@ -35,11 +48,17 @@ namespace fm
     // export
     class System;
     class Vector;
+    class SparseVector;
     typedef std::vector<Vector> Matrix;
 
-    typedef int Value;
+    typedef FM_VALUE Value;
+    typedef widen<Value>::type Wide;    // intermediate results
     typedef Vec<Value> ValArray;
 
+    // Chernikov origin set of a row: the input rows it is combined from
+    // (one bit per input row)
+    typedef boost::dynamic_bitset<> Origin;
+
 
     struct SolveToCallback;
     struct EliminateCallback;
@@ -49,7 +68,8 @@ namespace fm
     class System
     {
     public:
-        Matrix ineqs;
+        Matrix ineqs;           // rows v with v*x >= 0
+        Matrix eqs;             // rows v with v*x == 0
         size_t num_cols;
 
         explicit System(size_t nb_lines, size_t nb_cols);
@@ -70,6 +90,24 @@ namespace fm
         void add_inequality(Vector&& v);
         void add_equality(Vector&& v);
 
+        // move pairs of opposite inequalities into the equality block
+        size_t find_equalities();
+        // move all inequalities that are tight on the whole cone into the
+        // equality block (and drop linearly dependent equalities)
+        size_t find_implicit_equalities();
+        // dimension of the affine hull
+        size_t dimension() const;
+        // store each equality as two opposite inequalities
+        void split_equalities();
+        // equality with the smallest nonzero coefficient in the column
+        int find_pivot(size_t index) const;
+        // use an equality to eliminate the given column
+        bool substitute(size_t index);
+        // keep only the rows that do not involve the columns from num_cols
+        // on, and drop these columns (an outer approximation of the
+        // projection)
+        void truncate(size_t num_cols);
+
         Problem problem() const;
 
         friend std::ostream& operator << (std::ostream&, const System&);
@@ -108,6 +146,10 @@ namespace fm
         Value get(size_t i) const;
 
         Vector eliminate(const Vector& v, size_t i) const;
+        // same, writing into reusable buffers (no allocations once the
+        // buffers have the right size)
+        void eliminate(const Vector& v, size_t i,
+                       Vector& out, std::vector<Wide>& scratch) const;
         void remove(size_t i);
         void normalize();
 
@@ -122,8 +164,41 @@ namespace fm
     Vector scaled_addition(const Vector& v0, Value s0,
                            const Vector& v1, Value s1);
 
+
+    // Sorted (index, value) pairs of the nonzero coefficients. Rows of
+    // entropy systems often have only a handful of nonzeros, so combining
+    // them in this form only costs O(nonzeros) instead of O(columns).
+    class SparseVector
+    {
+    public:
+        std::vector<int> index;
+        std::vector<Value> value;
+        size_t dim;
+
+        explicit SparseVector(size_t dim=0);
+        explicit SparseVector(const Vector& v);
+
+        Vector dense() const;
+        size_t nnz() const;
+        Value get(size_t i) const;
+
+        SparseVector eliminate(const SparseVector& v, size_t i) const;
+        void eliminate(const SparseVector& v, size_t i,
+                       SparseVector& out, std::vector<Wide>& scratch) const;
+        void normalize();
+    };
+
+    // fraction of nonzero coefficients
+    double fill_ratio(const Matrix& m);
+
+    // estimated memory held by the rows (bytes)
+    size_t heap_size(const Matrix& m);
+    size_t heap_size(const std::vector<SparseVector>& m);
+    size_t heap_size(const System& s);
+
     size_t num_elemental_inequalities(size_t num_vars);
     fm::System elemental_inequalities(size_t num_vars);
+    std::vector<SparseVector> sparse_elemental_inequalities(size_t num_vars);
     void set_initial_state_iid(fm::System& s, size_t nf, size_t ni);
     void add_causal_constraints(fm::System& s, size_t nf, size_t ni, size_t links);
 
@@ -138,6 +213,15 @@ namespace fm
     Matrix parse_matrix(const std::vector<std::string>& lines);
 
     // status/control callbacks
+    //
+    // The algorithms are templates over their callback policy. The virtual
+    // `Callback` classes are the dynamic policy used for status output, the
+    // `Quiet` policies have empty inline hooks that compile away. A hook
+    // returns a guard that lives until the corresponding phase ends. These
+    // are the only two policies: `run_with` is private and defined in
+    // fm.cpp, custom status output derives from `Callback`.
+
+    struct NoGuard { ~NoGuard() {} };
 
     struct CallbackBase {
         virtual ~CallbackBase() {}
@@ -145,42 +229,172 @@ namespace fm
 
     struct minimize
     {
-        System& sys;
+        // Order in which rows are tested for redundancy. The earlier
+        // redundant rows are removed, the smaller the LP for later checks.
+        enum Order {
+            REVERSE,    // last to first, i.e. reverse generation order
+            DENSEST,    // most nonzero coefficients first
+            LARGEST,    // largest absolute coefficient first
+            RANDOM,     // random permutation
+            LEARNED,    // rows found redundant in previous runs first
+        };
 
+        System& sys;
+        Order order;
+        const Matrix* learned;      // redundant rows from previous runs
+        size_t first;               // rows before this index are not tested
+        const Group* group;         // test only one row per orbit (moves
+                                    // the implicit equalities to sys.eqs)
+        CancelToken* cancel;        // stop early (untested rows are kept)
+
+        // `accepted` is called for each tested row that is not implied by
+        // the others (and for the images of an orbit representative)
         struct Callback : CallbackBase {
             virtual SG enter(minimize*) const EMPTY(SG);
             virtual SG start_round(int i) const EMPTY(SG);
+            virtual void accepted(const Vector& row) const {}
+        };
+        struct Quiet {
+            NoGuard enter(minimize*) const EMPTY(NoGuard);
+            NoGuard start_round(int) const EMPTY(NoGuard);
+            void accepted(const Vector&) const {}
         };
-        void run(const Callback& cb=Callback());
+        void run();
+        void run(const Callback& cb);
+
+        std::vector<size_t> test_order() const;
+
+    private:
+        // (defined in fm.cpp for the two policies above only, other status
+        // output derives from Callback)
+        friend struct solve_to;
+        template <class CB> void run_with(const CB& cb);
+        template <class CB> void run_orbits(const CB& cb);
     };
 
+    minimize::Order parse_order(const std::string& name);
+    const char* order_name(minimize::Order order);
+
+    typedef P<minimize::Callback> MinimizePtr;
+
     struct eliminate
     {
+        // Order in which the p*n candidates are checked for redundancy.
+        // Every accepted row enlarges the LP for all later checks, so it
+        // pays to check the candidates most likely to be strong first.
+        enum Schedule {
+            POS_MAJOR,  // each positive row with all negative rows
+            SPARSEST,   // fewest nonzero coefficients first
+            NORM,       // smallest sum of absolute coefficients first
+            ORIGIN,     // smallest union of the origin sets first
+        };
+
         System& sys;
         int index;
-
+        Schedule schedule;
+        size_t purge;       // minimize new rows after this many accepted
+        size_t budget;      // bytes for the sorted candidate list, larger
+                            // lists are spilled to disk (0 = unlimited)
+        CancelToken* cancel;    // stop checking candidates
+        std::vector<Origin>* origins;   // of sys.ineqs, updated along with
+                                        // the rows (null: one row each)
+
+        // `progress` is only called every few hundred candidates
         struct Callback : CallbackBase {
             virtual SG enter(eliminate*) const EMPTY(SG);
             virtual SG start_append(int z, int p, int n) const EMPTY(SG);
-            virtual SG start_check(int index) const EMPTY(SG);
+            virtual void progress(size_t checked, size_t total) const {}
+            virtual SG start_substitute(int z, int e) const EMPTY(SG);
         };
-        void run(const Callback& cb=Callback());
+        struct Quiet {
+            NoGuard enter(eliminate*) const EMPTY(NoGuard);
+            NoGuard start_append(int, int, int) const EMPTY(NoGuard);
+            void progress(size_t, size_t) const {}
+            NoGuard start_substitute(int, int) const EMPTY(NoGuard);
+        };
+        void run();
+        void run(const Callback& cb);
+
+    private:
+        // (see minimize)
+        friend struct solve_to;
+        template <class CB> void run_with(const CB& cb);
     };
 
+    eliminate::Schedule parse_schedule(const std::string& name);
+    const char* schedule_name(eliminate::Schedule schedule);
+
     typedef P<eliminate::Callback> EliminatePtr;
 
+    // Conditions for minimizing the system in between elimination steps.
+    // A zero value disables the corresponding trigger.
+    struct MinimizePolicy
+    {
+        double growth = 0;      // row count grew by this factor
+        long max_pn = 0;        // predicted p*n of the next step exceeds this
+        double redundancy = 0;  // last minimize removed at least this fraction
+        int probe = 8;          // ... or every this many steps (the rate is
+                                // only measured when minimizing)
+        bool partial = false;   // skip the rows that passed the last
+                                // minimize (see SolveState::num_tested)
+        bool reduce = false;    // detect implicit equalities beforehand
+
+        bool enabled() const;
+    };
+
+    // Progress of a solve_to run, saved in checkpoints to resume from.
+    struct SolveState
+    {
+        int step = 0;
+        size_t num_minimized = 0;   // rows after the last minimize
+        size_t num_tested = 0;      // leading rows known to be irredundant
+        double rate = -1;           // redundancy rate of the last minimize
+        std::vector<int> order;     // eliminated columns
+    };
+
     struct solve_to
     {
         System& sys;
         int to;
+        MinimizePolicy policy;
+        eliminate::Schedule schedule;
+        size_t purge;
+        size_t budget;          // see eliminate::budget
+        SolveState state;       // updated after each step
+        Checkpoint* checkpoint; // saves the state after each step
+        CancelToken* cancel;    // stop early, see cancel.h
         int get_rank(int) const;
+        int best_index() const;
+        void count_signs(int index, int& pos, int& neg) const;
 
         struct Callback : CallbackBase {
             virtual SG enter(solve_to*) const EMPTY(SG);
             virtual SG start_step(int step) const EMPTY(SG);
             virtual EliminatePtr start_eliminate(int index) const;
+            virtual MinimizePtr start_minimize(int step,
+                                               const char* reason) const;
+            virtual SG found_equalities(int step, int num) const EMPTY(SG);
+            virtual SG finished_step(int step,
+                                     const memory::Usage& peak) const
+                EMPTY(SG);
+        };
+        struct Quiet {
+            NoGuard enter(solve_to*) const EMPTY(NoGuard);
+            NoGuard start_step(int) const EMPTY(NoGuard);
+            eliminate::Quiet start_eliminate(int) const
+                EMPTY(eliminate::Quiet);
+            minimize::Quiet start_minimize(int, const char*) const
+                EMPTY(minimize::Quiet);
+            NoGuard found_equalities(int, int) const EMPTY(NoGuard);
+            NoGuard finished_step(int, const memory::Usage&) const
+                EMPTY(NoGuard);
         };
-        void run(const Callback& cb=Callback());
+        void run();
+        void run(const Callback& cb);
+
+    private:
+        // (see minimize)
+        template <class CB> void run_with(const CB& cb);
     };
 
     typedef P<terminal::Input> InputPtr;
@@ -189,13 +403,27 @@ namespace fm
     {
         std::ostream* out;
         InputPtr inp;
+        bool show_memory = false;   // append memory usage to status lines
+        CancelToken* cancel = nullptr;  // cancelled by the 'c' key
         IO(std::ostream*, InputPtr=InputPtr());
     };
 
+    // Lets status updates pass at most once per interval (wall time):
+    struct RateLimit
+    {
+        boost::timer::cpu_timer timer;
+        boost::timer::nanosecond_type interval = 100000000;
+        boost::timer::nanosecond_type next = 0;
+        bool operator()();
+    };
+
     struct MinimizeStatusOutput : minimize::Callback, IO
     {
         mutable System* sys;
         mutable int num_orig;
+        mutable minimize::Order order;
+        mutable boost::timer::cpu_timer timer;
+        mutable RateLimit rate;
         MinimizeStatusOutput(IO io) : IO(io) {}
         ~MinimizeStatusOutput();
         SG enter(minimize*) const                       override;
@@ -205,10 +433,14 @@ namespace fm
     struct EliminateStatusOutput : eliminate::Callback, IO
     {
         mutable System* sys;
+        mutable int z, p, n;
+        mutable RateLimit rate;
         EliminateStatusOutput(IO io) : IO(io) {}
         ~EliminateStatusOutput();
         SG enter(eliminate*) const                      override;
         SG start_append(int z, int p, int n) const      override;
+        void progress(size_t checked, size_t total) const override;
+        SG start_substitute(int z, int e) const         override;
     };
 
     struct SolveToStatusOutput : solve_to::Callback, IO
@@ -219,6 +451,9 @@ namespace fm
         SG enter(solve_to*) const                       override;
         SG start_step(int step) const                   override;
         EliminatePtr start_eliminate(int index) const   override;
+        MinimizePtr start_minimize(int step,
+                                   const char* reason) const override;
+        SG found_equalities(int step, int num) const    override;
     };
 
 }
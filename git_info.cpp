@@ -0,0 +1,7 @@
+
+namespace git
+{
+    const char* commit = "c39e6fdf530fa40e884215fdbf48896ced5265c6";
+    bool has_uncommitted_changes = true;
+}
+
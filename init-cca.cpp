@@ -3,11 +3,17 @@
 //   corresponding causal constraints
 // - set the first layer to be mutual independent
 // - minimize the system of inequalites
-// - print all vectors to STDOUT
+// - print all vectors to STDOUT (see sysfile.h for --compact, --sparse
+//   and --binary)
+//
+// The result is looked up in and stored to the result cache (see cache.h,
+// --cache=DIR, --no-cache).
 
 #include <cstdlib>      // atol
 #include <iostream>
 #include "fm.h"
+#include "cache.h"
+#include "sysfile.h"
 
 #include "util.h"
 
@@ -16,7 +22,7 @@ using namespace std;
 
 int usage(int argc, char** argv)
 {
-    cerr << "Usage: " << argv[0] << " WIDTH [NUM_LINKS [NUM_INIT]" << endl;
+    cerr << "Usage: " << argv[0] << " WIDTH [NUM_LINKS [NUM_INIT]]" << endl;
     return 1;
 }
 
@@ -24,25 +30,39 @@ int usage(int argc, char** argv)
 int main(int argc, char** argv, char** env)
 try
 {
-    if (argc < 2 || argc > 4) {
+    util::Args args(argc, argv);
+    auto& pos = args.pos;
+    if (pos.size() < 1 || pos.size() > 3) {
         return usage(argc, argv);
     }
 
-    size_t nf = atol(argv[1]);                  // num vars in final layer
-    size_t nl = argc >= 3 ? atol(argv[2]) : 2;  // num links for each variable
-    size_t ni = argc >= 4 ? atol(argv[3]) : nf; // num vars in initial layer
+    // num vars in final layer, num links for each variable, num vars in
+    // initial layer:
+    size_t nf = atol(pos[0].c_str());
+    size_t nl = pos.size() >= 2 ? atol(pos[1].c_str()) : 2;
+    size_t ni = pos.size() >= 3 ? atol(pos[2].c_str()) : nf;
     size_t num_vars = nf + ni;
 
     util::AutogenNotice gen(argc, argv);
 
-    fm::System system = fm::elemental_inequalities(num_vars);
+    fm::Cache cache(args);
+    string cache_key = cache.key(util::join(" ", "init-cca", nf, nl, ni));
+    fm::System system(0, 0);
+    string cached_header;
+    if (cache.load(cache_key, system, &cached_header)) {
+        fm::write_system(cout, system, gen.str() + "\n#\n" + cached_header,
+                         fm::output_format(args));
+        return 0;
+    }
+
+    system = fm::elemental_inequalities(num_vars);
 
     fm::set_initial_state_iid(system, nf, ni);
     fm::add_causal_constraints(system, nf, ni, nl);
     fm::minimize{system}.run(fm::MinimizeStatusOutput(&cerr));
 
-    cout << gen.str() << endl;
-    cout << system << endl;
+    cache.store(cache_key, system, gen.str() + "\n");
+    fm::write_system(cout, system, gen.str() + "\n", fm::output_format(args));
 }
 catch (...)
 {
@@ -0,0 +1,435 @@
+// Vectorized kernels, see kernels.h.
+
+#include <type_traits>  // is_same
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# include <immintrin.h>
+# define HAVE_AVX2_KERNELS
+#endif
+
+#include "kernels.h"
+#include "number.h"
+
+
+namespace fm
+{
+namespace kernel
+{
+
+    // The AVX2 kernels are written for 32 bit coefficients with 64 bit
+    // intermediates, i.e. the default Value type:
+    static const bool native_types =
+        std::is_same<Value, int>::value &&
+        std::is_same<Wide, long long>::value;
+
+    static bool detect_simd()
+    {
+#ifdef HAVE_AVX2_KERNELS
+        __builtin_cpu_init();
+        return native_types && __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    static bool use_simd = detect_simd();
+
+    bool simd_available()
+    {
+        return detect_simd();
+    }
+
+    bool simd_enabled()
+    {
+        return use_simd;
+    }
+
+    void set_simd(bool enable)
+    {
+        use_simd = enable && simd_available();
+    }
+
+    template <class Int>
+    static int trailing_zeros(Int a)
+    {
+        int k = 0;
+        for (; !(a & 1); a >>= 1) {
+            ++k;
+        }
+        return k;
+    }
+
+    static int trailing_zeros(int a) { return __builtin_ctz(a); }
+    static int trailing_zeros(long long a) { return __builtin_ctzll(a); }
+
+    // Binary gcd (Stein's algorithm) of nonnegative numbers, avoids the
+    // divisions of Euclid's algorithm.
+    template <class Int>
+    static Int binary_gcd(Int a, Int b)
+    {
+        if (a == 0)
+            return b;
+        if (b == 0)
+            return a;
+        int shift = trailing_zeros(a | b);
+        a >>= trailing_zeros(a);
+        do {
+            b >>= trailing_zeros(b);
+            if (a > b) {
+                Int t = a;
+                a = b;
+                b = t;
+            }
+            b -= a;
+        } while (b);
+        return a << shift;
+    }
+
+    template <class Int>
+    static Int scalar_row_gcd(const Int* x, size_t n)
+    {
+        Int g = 0;
+        for (size_t j = 0; j < n; ++j) {
+            Int a = x[j] < 0 ? -x[j] : x[j];
+            g = binary_gcd(g, a);
+            if (g == 1) {
+                break;
+            }
+        }
+        return g;
+    }
+
+    // Fixed width versions for blocks of 8 to 32 columns. With the trip
+    // count known at compile time, the loops are fully unrolled and
+    // vectorized for any value type.
+    template <size_t N>
+    static void fixed_combine(const Value* __restrict a, Wide s0,
+                              const Value* __restrict b, Wide s1,
+                              Wide* __restrict out)
+    {
+        for (size_t j = 0; j < N; ++j) {
+            out[j] = s0 * a[j] + s1 * b[j];
+        }
+    }
+
+    template <size_t N>
+    static void fixed_count_signs(const Value* __restrict row,
+                                  int* __restrict pos, int* __restrict neg)
+    {
+        for (size_t j = 0; j < N; ++j) {
+            pos[j] += row[j] > 0;
+            neg[j] += row[j] < 0;
+        }
+    }
+
+    static void scalar_combine(const Value* a, Wide s0,
+                               const Value* b, Wide s1,
+                               Wide* out, size_t n)
+    {
+        size_t j = 0;
+        for (; j + 32 <= n; j += 32) {
+            fixed_combine<32>(a+j, s0, b+j, s1, out+j);
+        }
+        if (j + 16 <= n) {
+            fixed_combine<16>(a+j, s0, b+j, s1, out+j);
+            j += 16;
+        }
+        if (j + 8 <= n) {
+            fixed_combine<8>(a+j, s0, b+j, s1, out+j);
+            j += 8;
+        }
+        for (; j < n; ++j) {
+            out[j] = s0 * a[j] + s1 * b[j];
+        }
+    }
+
+    // Divisions are skipped for g == 1 (the common case), and the range
+    // check is done without branching to keep the loops vectorizable.
+    template <class T>
+    static void scalar_divide_narrow(const Wide* x, Wide g, T* out, size_t n)
+    {
+        bool fits = true;
+        if (g == 1) {
+            for (size_t j = 0; j < n; ++j) {
+                out[j] = T(x[j]);
+                fits &= Wide(out[j]) == x[j];
+            }
+        }
+        else {
+            for (size_t j = 0; j < n; ++j) {
+                Wide y = x[j] / g;
+                out[j] = T(y);
+                fits &= Wide(out[j]) == y;
+            }
+        }
+        if (!fits) {
+            throw std::overflow_error(
+                    "Integer overflow: coefficient exceeds the value type.");
+        }
+    }
+
+    // Fused row operation for a width N known at compile time (see
+    // `FixedEliminate`), compiled once for the baseline and once for the
+    // AVX2 instruction set. Most combined rows of entropy systems contain a
+    // coefficient of +-1, which is checked first to skip the gcd.
+    template <size_t N>
+    __attribute__((always_inline))
+    inline static void fixed_eliminate_body(const Value* a_, const Value* b_,
+                                            size_t i, Value* out_)
+    {
+        auto a = (const Value*) __builtin_assume_aligned(a_, fixed_align);
+        auto b = (const Value*) __builtin_assume_aligned(b_, fixed_align);
+        auto out = (Value*) __builtin_assume_aligned(out_, fixed_align);
+        Wide x = a[i], y = b[i];
+        Wide s = -sign(x*y);
+        x = x < 0 ? -x : x;
+        y = y < 0 ? -y : y;
+        Wide div = gcd(x, y);
+        Wide s0 = y / div, s1 = s * (x / div);
+
+        // (products of two narrow values compile to widening multiplies)
+        Wide w[N+1];
+        Value v0 = Value(s0), v1 = Value(s1);
+        if (v0 == s0 && v1 == s1) {
+            for (size_t j = 0; j < N; ++j) {
+                w[j] = Wide(v0) * Wide(a[j]) + Wide(v1) * Wide(b[j]);
+            }
+        }
+        else {
+            fixed_combine<N>(a, s0, b, s1, w);
+        }
+        w[N] = 0;
+
+        // Drop column i (which is 0 after the combination, so that the gcd
+        // does not change). The reductions are on wide integers rather than
+        // bools, which the compiler vectorizes:
+        Wide d[N];
+        for (size_t j = 0; j < N; ++j) {
+            d[j] = w[j+1];
+        }
+        for (size_t j = 0; j < i; ++j) {
+            d[j] = w[j];
+        }
+        Wide unit = 0;
+        for (size_t j = 0; j < N; ++j) {
+            unit |= (d[j] == 1) | (d[j] == -1);
+        }
+        Wide g = unit ? 1 : scalar_row_gcd(d, N);
+        Wide bad = 0;
+        if (g <= 1) {
+            for (size_t j = 0; j < N; ++j) {
+                out[j] = Value(d[j]);
+                bad |= Wide(out[j]) ^ d[j];
+            }
+        }
+        else {
+            for (size_t j = 0; j < N; ++j) {
+                Wide v = d[j] / g;
+                out[j] = Value(v);
+                bad |= Wide(out[j]) ^ v;
+            }
+        }
+        if (bad) {
+            throw std::overflow_error(
+                    "Integer overflow: coefficient exceeds the value type.");
+        }
+    }
+
+    template <size_t N>
+    static void fixed_eliminate_n(const Value* a, const Value* b, size_t i,
+                                  Value* out)
+    {
+        fixed_eliminate_body<N>(a, b, i, out);
+    }
+
+    static void scalar_count_signs(const Value* __restrict row, size_t n,
+                                   int* __restrict pos, int* __restrict neg)
+    {
+        size_t j = 0;
+        for (; j + 32 <= n; j += 32) {
+            fixed_count_signs<32>(row+j, pos+j, neg+j);
+        }
+        if (j + 16 <= n) {
+            fixed_count_signs<16>(row+j, pos+j, neg+j);
+            j += 16;
+        }
+        if (j + 8 <= n) {
+            fixed_count_signs<8>(row+j, pos+j, neg+j);
+            j += 8;
+        }
+        for (; j < n; ++j) {
+            pos[j] += row[j] > 0;
+            neg[j] += row[j] < 0;
+        }
+    }
+
+#ifdef HAVE_AVX2_KERNELS
+
+    // Products of sign extended 32 bit lanes, valid for |s0|,|s1| < 2^31.
+    __attribute__((target("avx2")))
+    static void avx2_combine(const int* a, long long s0,
+                             const int* b, long long s1,
+                             long long* out, size_t n)
+    {
+        __m256i f0 = _mm256_set1_epi64x(s0);
+        __m256i f1 = _mm256_set1_epi64x(s1);
+        size_t j = 0;
+        for (; j + 4 <= n; j += 4) {
+            __m256i x = _mm256_cvtepi32_epi64(
+                    _mm_loadu_si128((const __m128i*) (a+j)));
+            __m256i y = _mm256_cvtepi32_epi64(
+                    _mm_loadu_si128((const __m128i*) (b+j)));
+            __m256i r = _mm256_add_epi64(_mm256_mul_epi32(x, f0),
+                                         _mm256_mul_epi32(y, f1));
+            _mm256_storeu_si256((__m256i*) (out+j), r);
+        }
+        for (; j < n; ++j) {
+            out[j] = s0 * a[j] + s1 * b[j];
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void avx2_count_signs(const int* row, size_t n,
+                                 int* pos, int* neg)
+    {
+        __m256i zero = _mm256_setzero_si256();
+        size_t j = 0;
+        for (; j + 8 <= n; j += 8) {
+            __m256i x = _mm256_loadu_si256((const __m256i*) (row+j));
+            __m256i p = _mm256_loadu_si256((const __m256i*) (pos+j));
+            __m256i q = _mm256_loadu_si256((const __m256i*) (neg+j));
+            // the comparisons yield -1 for true:
+            p = _mm256_sub_epi32(p, _mm256_cmpgt_epi32(x, zero));
+            q = _mm256_sub_epi32(q, _mm256_cmpgt_epi32(zero, x));
+            _mm256_storeu_si256((__m256i*) (pos+j), p);
+            _mm256_storeu_si256((__m256i*) (neg+j), q);
+        }
+        for (; j < n; ++j) {
+            pos[j] += row[j] > 0;
+            neg[j] += row[j] < 0;
+        }
+    }
+
+    // Finds the common power of two of the whole row with one vectorized
+    // OR, so that the scalar binary gcd only needs to handle odd parts.
+    __attribute__((target("avx2")))
+    static long long avx2_row_gcd(const long long* x, size_t n)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        size_t j = 0;
+        for (; j + 4 <= n; j += 4) {
+            acc = _mm256_or_si256(acc,
+                    _mm256_loadu_si256((const __m256i*) (x+j)));
+        }
+        long long lanes[4];
+        _mm256_storeu_si256((__m256i*) lanes, acc);
+        unsigned long long bits = lanes[0] | lanes[1] | lanes[2] | lanes[3];
+        for (; j < n; ++j) {
+            bits |= x[j];
+        }
+        if (bits == 0) {
+            return 0;
+        }
+        // (two's complement preserves the trailing zeros of negatives)
+        int shift = trailing_zeros((long long) bits);
+        long long g = 0;
+        for (j = 0; j < n && g != 1; ++j) {
+            long long a = x[j] < 0 ? -x[j] : x[j];
+            if (a) {
+                a >>= trailing_zeros(a);
+                g = binary_gcd(g, a);
+            }
+        }
+        return g << shift;
+    }
+
+    template <size_t N>
+    __attribute__((target("avx2")))
+    static void avx2_fixed_eliminate_n(const Value* a, const Value* b,
+                                       size_t i, Value* out)
+    {
+        fixed_eliminate_body<N>(a, b, i, out);
+    }
+
+#endif
+
+    // dispatch
+
+    void combine(const Value* a, Wide s0, const Value* b, Wide s1,
+                 Wide* out, size_t n)
+    {
+#ifdef HAVE_AVX2_KERNELS
+        const Wide lim = Wide(1) << 31;
+        if (use_simd && s0 < lim && -s0 < lim && s1 < lim && -s1 < lim) {
+            avx2_combine((const int*) a, s0, (const int*) b, s1,
+                         (long long*) out, n);
+            return;
+        }
+#endif
+        scalar_combine(a, s0, b, s1, out, n);
+    }
+
+    Wide row_gcd(const Wide* x, size_t n)
+    {
+#ifdef HAVE_AVX2_KERNELS
+        if (use_simd) {
+            return avx2_row_gcd((const long long*) x, n);
+        }
+#endif
+        return scalar_row_gcd(x, n);
+    }
+
+    Value row_gcd(const Value* x, size_t n)
+    {
+        return scalar_row_gcd(x, n);
+    }
+
+    void divide_narrow(const Wide* x, Wide g, Value* out, size_t n)
+    {
+        scalar_divide_narrow(x, g, out, n);
+    }
+
+    size_t fixed_width(size_t n)
+    {
+        for (size_t width = 8; width <= 64; width *= 2) {
+            if (n <= width) {
+                return width;
+            }
+        }
+        return 0;
+    }
+
+    FixedEliminate fixed_eliminate(size_t width)
+    {
+#ifdef HAVE_AVX2_KERNELS
+        if (use_simd) {
+            switch (width) {
+                case 8:  return avx2_fixed_eliminate_n<8>;
+                case 16: return avx2_fixed_eliminate_n<16>;
+                case 32: return avx2_fixed_eliminate_n<32>;
+                case 64: return avx2_fixed_eliminate_n<64>;
+            }
+        }
+#endif
+        switch (width) {
+            case 8:  return fixed_eliminate_n<8>;
+            case 16: return fixed_eliminate_n<16>;
+            case 32: return fixed_eliminate_n<32>;
+            case 64: return fixed_eliminate_n<64>;
+        }
+        return nullptr;
+    }
+
+    void count_signs(const Value* row, size_t n, int* pos, int* neg)
+    {
+#ifdef HAVE_AVX2_KERNELS
+        if (use_simd) {
+            avx2_count_signs((const int*) row, n, pos, neg);
+            return;
+        }
+#endif
+        scalar_count_signs(row, n, pos, neg);
+    }
+
+}
+}
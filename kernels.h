@@ -0,0 +1,62 @@
+// Vectorized kernels for the hot loops of the elimination (combining rows,
+// normalizing and counting signs). An AVX2 implementation is selected at
+// runtime if the CPU supports it, otherwise a scalar fallback is used, which
+// runs fully unrolled loops over blocks of 32, 16 and 8 columns.
+//
+// Systems of at most 64 columns (up to 6 random variables) use the fixed
+// width kernels instead, which are instantiated for each width, so that
+// the whole row operation is unrolled and vectorized by the compiler.
+
+#ifndef __KERNELS_H__INCLUDED__
+#define __KERNELS_H__INCLUDED__
+
+# include <cstddef>     // size_t
+
+# include "fm.h"        // Value, Wide
+
+
+namespace fm
+{
+namespace kernel
+{
+
+    // out[j] = s0*a[j] + s1*b[j] (computed in the wide type)
+    void combine(const Value* a, Wide s0, const Value* b, Wide s1,
+                 Wide* out, size_t n);
+
+    // gcd of the absolute values, returns early once it reaches 1
+    Wide row_gcd(const Wide* x, size_t n);
+    Value row_gcd(const Value* x, size_t n);
+
+    // out[j] = x[j] / g, throws overflow_error if a result does not fit
+    void divide_narrow(const Wide* x, Wide g, Value* out, size_t n);
+
+    // pos[j] += (row[j] > 0), neg[j] += (row[j] < 0)
+    void count_signs(const Value* row, size_t n, int* pos, int* neg);
+
+    // Fixed width kernels for rows of N = 8, 16, 32 or 64 values, padded
+    // with zeros and aligned to `fixed_align` bytes.
+    const size_t fixed_align = 32;
+
+    // Smallest supported width N >= n, or 0 if there is none.
+    size_t fixed_width(size_t n);
+
+    // out = the combination of a and b in which column i cancels, divided
+    // by its gcd, with column i dropped (the last value becomes 0). Throws
+    // overflow_error if a result does not fit.
+    typedef void (*FixedEliminate)(const Value* a, const Value* b, size_t i,
+                                   Value* out);
+
+    // Kernel for the given width (as returned by `fixed_width`).
+    FixedEliminate fixed_eliminate(size_t width);
+
+    // Whether the AVX2 kernels are available, and whether they are used.
+    // Disabling them is only meant for benchmarks and debugging.
+    bool simd_available();
+    bool simd_enabled();
+    void set_simd(bool enable);
+
+}
+}
+
+#endif  // include guard
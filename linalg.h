@@ -1,11 +1,12 @@
 #ifndef __LINALG_H__INCLUDED__
 #define __LINALG_H__INCLUDED__
 
-# include <algorithm>   // copy
+# include <algorithm>   // copy, max
 # include <iterator>    // istream_iterator, back_inserter
 # include <iostream>
 # include <string>
 # include <sstream>     // istringstream
+# include <utility>     // pair, move
 # include <valarray>
 # include <vector>
 
@@ -21,30 +22,94 @@ namespace la
     template <class T>
     Vector<T> parse_vector(std::string line)
     {
-        typedef std::istream_iterator<T> iit;
+        // read character types as numbers:
+        typedef decltype(+T()) R;
+        typedef std::istream_iterator<R> iit;
         // backward compatibility for now (remove this later…):
         if (line.front() == '[') {
             assert_eq(line.back(), ']', parse_error, "expecting ']'", line);
             line = util::trim(line.substr(1, line.size()-2));
         }
-        std::vector<T> vals;
+        std::vector<R> vals;
         std::istringstream in(line);
         std::copy(iit(in), iit(), std::back_inserter(vals));
         Vector<T> r(vals.size());
-        std::copy(vals.begin(), vals.end(), std::begin(r));
+        for (int i = 0; i < vals.size(); ++i) {
+            r[i] = vals[i];
+            _assert(r[i] == vals[i], parse_error, "value out of range", line);
+        }
         return r;
     }
 
+    // Sparse row of "col:coef" pairs. If the dimension is not known (zero),
+    // the row ends at the last nonzero.
+    template <class T>
+    Vector<T> parse_sparse_vector(const std::string& line, size_t dim)
+    {
+        typedef decltype(+T()) R;
+        std::vector<std::pair<size_t, R>> vals;
+        std::istringstream in(line);
+        std::string token;
+        size_t size = dim;
+        while (in >> token) {
+            size_t sep = token.find(':');
+            _assert(sep != std::string::npos, parse_error,
+                    "expecting col:coef", line);
+            std::istringstream col(token.substr(0, sep));
+            std::istringstream val(token.substr(sep+1));
+            std::pair<size_t, R> v;
+            _assert(col >> v.first && val >> v.second, parse_error,
+                    "expecting col:coef", line);
+            _assert(!dim || v.first < dim, parse_error,
+                    "column out of range", line);
+            size = std::max(size, v.first + 1);
+            vals.push_back(v);
+        }
+        Vector<T> r(size);
+        for (auto&& v : vals) {
+            r[v.first] = v.second;
+            _assert(r[v.first] == v.second, parse_error,
+                    "value out of range", line);
+        }
+        return r;
+    }
+
+    // Dense rows, or sparse rows (see parse_sparse_vector) after a
+    // "# dim: N" header line.
     template <class T>
     Matrix<T> parse_matrix(const std::vector<std::string>& lines)
     {
         Matrix<T> r;
+        size_t dim = 0;
+        bool sparse = false;
         for (std::string line : lines) {
+            if (line.compare(0, 6, "# dim:") == 0) {
+                dim = std::stoul(line.substr(6));
+            }
             line = util::remove_comment(line);
             line = util::trim(line);
             if (line.empty())
                 continue;
-            r.push_back(parse_vector<T>(line));
+            if (line.find(':') != std::string::npos) {
+                r.push_back(parse_sparse_vector<T>(line, dim));
+                sparse = true;
+            }
+            else {
+                r.push_back(parse_vector<T>(line));
+            }
+        }
+        // pad the sparse rows of unknown dimension:
+        if (sparse && !dim) {
+            for (auto&& v : r) {
+                dim = std::max(dim, v.size());
+            }
+            for (auto&& v : r) {
+                if (v.size() < dim) {
+                    Vector<T> w(dim);
+                    w[std::slice(0, v.size(), 1)] = v;
+                    v = std::move(w);
+                }
+            }
         }
         return r;
     }
@@ -72,7 +137,7 @@ namespace la
     {
         for (auto val : vec) {
             out.width(3);
-            out << val << ' ';
+            out << +val << ' ';
         }
         return out;
     }
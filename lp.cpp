@@ -42,14 +42,18 @@ namespace lp
                 indices.size(), indices.data()-1, values.data()-1);
     }
 
-    void Problem::add_equality(const Vector& v, double rhs)
+    void Problem::set_mat_row(int i, const std::vector<int>& index,
+                              const std::vector<double>& value)
     {
-        int i = glp_add_rows(prob.get(), 1)-1;
-        glp_set_row_bnds(prob.get(), i, GLP_FX, rhs, rhs);
-        set_mat_row(i, v);
+        std::vector<int> indices(index.size());
+        for (int k = 0; k < index.size(); ++k) {
+            indices[k] = index[k]+1;
+        }
+        glp_set_mat_row(prob.get(), i+1,
+                indices.size(), indices.data()-1, value.data()-1);
     }
 
-    void Problem::add_inequality(const Vector& v, double lb, double ub)
+    int Problem::add_row(double lb, double ub)
     {
         int i = glp_add_rows(prob.get(), 1)-1;
         if (lb == -INFINITY && ub == INFINITY) {
@@ -59,30 +63,76 @@ namespace lp
             glp_set_row_bnds(prob.get(), i+1, GLP_LO, lb, NAN);
         }
         else if (lb == -INFINITY && ub < INFINITY) {
-            glp_set_row_bnds(prob.get(), i+1, GLP_LO, NAN, ub);
+            glp_set_row_bnds(prob.get(), i+1, GLP_UP, NAN, ub);
         }
         else {
             glp_set_row_bnds(prob.get(), i+1, GLP_DB, lb, ub);
         }
+        return i;
+    }
+
+    void Problem::add_equality(const Vector& v, double rhs)
+    {
+        int i = glp_add_rows(prob.get(), 1)-1;
+        glp_set_row_bnds(prob.get(), i+1, GLP_FX, rhs, rhs);
         set_mat_row(i, v);
     }
 
+    void Problem::add_inequality(const Vector& v, double lb, double ub)
+    {
+        set_mat_row(add_row(lb, ub), v);
+    }
+
+    void Problem::add_inequality(const std::vector<int>& index,
+                                 const std::vector<double>& value,
+                                 double lb, double ub)
+    {
+        set_mat_row(add_row(lb, ub), index, value);
+    }
+
     void Problem::del_row(int i)
     {
         glp_del_rows(prob.get(), 1, (&++i)-1);
     }
 
+    void Problem::del_rows(int first, int count)
+    {
+        std::vector<int> rows(count);
+        for (int k = 0; k < count; ++k) {
+            rows[k] = first+k+1;
+        }
+        glp_del_rows(prob.get(), count, rows.data()-1);
+    }
+
+    // Rough estimate: GLPK keeps an object per row and column and a list
+    // element per nonzero (the basis factorization is not counted).
+    size_t Problem::heap_size() const
+    {
+        return (glp_get_num_rows(prob.get()) + num_cols) * 128
+            + size_t(glp_get_num_nz(prob.get())) * 56;
+    }
+
     bool Problem::is_redundant(const Vector& v) const
     {
         return simplex(v) == OPT;
     }
 
+    void Problem::set_obj_coef(int j, double v) const
+    {
+        glp_set_obj_coef(prob.get(), j+1, v);
+    }
+
     Status Problem::simplex(const Vector& v, Vector* o) const
     {
         assert_eq_size(v.size(), num_cols);
         for (int i = 0; i < num_cols; ++i) {
-            glp_set_obj_coef(prob.get(), i+1, v[i]);
+            set_obj_coef(i, v[i]);
         }
+        return solve(o);
+    }
+
+    Status Problem::solve(Vector* o) const
+    {
         glp_std_basis(prob.get());
         glp_smcp parm;
         glp_init_smcp(&parm);
@@ -129,19 +179,4 @@ namespace lp
         return true;
     }
 
-    void Problem::add_equality(const iVector& v, double rhs)
-    {
-        add_equality(la::convert<double>(v), rhs);
-    }
-
-    void Problem::add_inequality(const iVector& v, double lb, double ub)
-    {
-        add_inequality(la::convert<double>(v), lb, ub);
-    }
-
-    bool Problem::is_redundant(const iVector& v) const
-    {
-        return is_redundant(la::convert<double>(v));
-    }
-
 }
@@ -1,7 +1,9 @@
 #ifndef __LP_H__INCLUDED__
 #define __LP_H__INCLUDED__
 
+# include <cmath>     // INFINITY
 # include <memory>
+# include <vector>
 # include "linalg.h"
 
 
@@ -13,7 +15,6 @@ namespace lp
     template <class T> using P = std::shared_ptr<T>;
 
     typedef la::Vector<double> Vector;
-    typedef la::Vector<int>   iVector;
 
     enum Status {
         UNDEF=1,/* solution is undefined */
@@ -32,6 +33,11 @@ namespace lp
         P<glp_prob> prob;
 
         void set_mat_row(int i, const Vector&);
+        void set_mat_row(int i, const std::vector<int>& index,
+                         const std::vector<double>& value);
+        int add_row(double lb, double ub);
+        void set_obj_coef(int j, double v) const;
+        Status solve(Vector* o=nullptr) const;
     public:
         size_t num_cols;
 
@@ -40,15 +46,65 @@ namespace lp
 
         void add_equality(const Vector&, double rhs=0);
         void add_inequality(const Vector&, double lb=0, double ub=INFINITY);
+        // sparse row given by (sorted) column indices and values
+        void add_inequality(const std::vector<int>& index,
+                            const std::vector<double>& value,
+                            double lb=0, double ub=INFINITY);
         void del_row(int i);
+        void del_rows(int first, int count);
+
+        // estimated memory held by the LP backend (bytes)
+        size_t heap_size() const;
 
         bool is_redundant(const Vector&) const;
         Status simplex(const Vector&, Vector* o=nullptr) const;
         bool dual(const Vector&, Vector&) const;
 
-        void add_equality(const iVector&, double rhs=0);
-        void add_inequality(const iVector&, double lb=0, double ub=INFINITY);
-        bool is_redundant(const iVector&) const;
+        // integer coefficients (of any width)
+        template <class T>
+        void add_equality(const la::Vector<T>& v, double rhs=0)
+        {
+            add_equality(la::convert<double>(v), rhs);
+        }
+
+        template <class T>
+        void add_inequality(const la::Vector<T>& v,
+                            double lb=0, double ub=INFINITY)
+        {
+            add_inequality(la::convert<double>(v), lb, ub);
+        }
+
+        template <class T>
+        void add_inequality(const std::vector<int>& index,
+                            const std::vector<T>& value,
+                            double lb=0, double ub=INFINITY)
+        {
+            add_inequality(index, std::vector<double>(value.begin(),
+                                                      value.end()), lb, ub);
+        }
+
+        // (the objective is set directly, without converting the vector)
+        template <class T>
+        bool is_redundant(const la::Vector<T>& v) const
+        {
+            assert_eq_size(v.size(), num_cols);
+            for (int j = 0; j < num_cols; ++j) {
+                set_obj_coef(j, v[j]);
+            }
+            return solve() == OPT;
+        }
+
+        // sparse objective given by (sorted) column indices and values
+        template <class T>
+        bool is_redundant(const std::vector<int>& index,
+                          const std::vector<T>& value) const
+        {
+            for (int j = 0, k = 0; j < num_cols; ++j) {
+                bool nz = k < index.size() && index[k] == j;
+                set_obj_coef(j, nz ? double(value[k++]) : 0.0);
+            }
+            return solve() == OPT;
+        }
     };
 
 }
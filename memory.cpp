@@ -0,0 +1,121 @@
+// Memory accounting, see memory.h.
+
+#include <algorithm>    // max
+#include <cstdio>       // fopen, fscanf
+#include <sstream>
+#include <iomanip>      // setprecision
+
+#include <sys/resource.h>   // getrusage
+#include <unistd.h>         // sysconf
+
+#include "memory.h"
+
+
+namespace memory
+{
+
+    static const char* subsystem_names[] = {
+        "system", "lp", "candidates", "io",
+    };
+
+    // (per thread, see memory.h)
+    static thread_local size_t usage[NUM_SUBSYSTEMS];
+    static thread_local Usage run_peak, cur_peak;
+
+    const char* subsystem_name(Subsystem s)
+    {
+        return subsystem_names[s];
+    }
+
+    static void update(Usage& u, Subsystem s, size_t bytes, size_t total)
+    {
+        u.peak[s] = std::max(u.peak[s], bytes);
+        u.peak_total = std::max(u.peak_total, total);
+    }
+
+    void record(Subsystem s, size_t bytes)
+    {
+        usage[s] = bytes;
+        size_t total = current_total();
+        update(run_peak, s, bytes, total);
+        update(cur_peak, s, bytes, total);
+    }
+
+    size_t current(Subsystem s)
+    {
+        return usage[s];
+    }
+
+    size_t current_total()
+    {
+        size_t total = 0;
+        for (size_t bytes : usage) {
+            total += bytes;
+        }
+        return total;
+    }
+
+    Usage peak()
+    {
+        Usage u = run_peak;
+        u.peak_rss = peak_rss();
+        return u;
+    }
+
+    Usage period_peak()
+    {
+        Usage u = cur_peak;
+        u.peak_rss = peak_rss();
+        return u;
+    }
+
+    // (the peak RSS of a period is that of the process up to its end)
+    Usage start_period()
+    {
+        Usage u = period_peak();
+        cur_peak = Usage();
+        size_t total = current_total();
+        for (int s = 0; s < NUM_SUBSYSTEMS; ++s) {
+            update(cur_peak, Subsystem(s), usage[s], total);
+        }
+        return u;
+    }
+
+    size_t current_rss()
+    {
+        long pages = 0, resident = 0;
+        FILE* f = fopen("/proc/self/statm", "r");
+        if (f) {
+            if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+                resident = 0;
+            }
+            fclose(f);
+        }
+        return size_t(resident) * sysconf(_SC_PAGESIZE);
+    }
+
+    size_t peak_rss()
+    {
+        rusage r;
+        getrusage(RUSAGE_SELF, &r);
+        return size_t(r.ru_maxrss) * 1024;     // (kilobytes on linux)
+    }
+
+    std::string format(size_t bytes)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << bytes / 1048576.0 << "M";
+        return out.str();
+    }
+
+    std::string summary(const Usage& u)
+    {
+        std::ostringstream out;
+        out << "rss " << format(u.peak_rss);
+        for (int s = 0; s < NUM_SUBSYSTEMS; ++s) {
+            out << ", " << subsystem_names[s] << " " << format(u.peak[s]);
+        }
+        return out.str();
+    }
+
+}
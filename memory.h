@@ -0,0 +1,63 @@
+// Memory accounting per subsystem. The algorithms report the current size
+// of their main data structures at natural sampling points (new rows,
+// progress reports, end of a step), and the peaks are recorded both for
+// the whole run and for the current period (e.g. elimination step).
+//
+// The values are estimates of the heap memory owned by the structures;
+// the resident set size of the process is reported alongside.
+//
+// The gauges are kept per thread, so that runs on different threads (e.g.
+// from the Python module, which releases the GIL) account separately and
+// do not race. Record and read them on the thread that runs the algorithms.
+
+#ifndef __MEMORY_H__INCLUDED__
+#define __MEMORY_H__INCLUDED__
+
+# include <cstddef>     // size_t
+# include <string>
+
+
+namespace memory
+{
+
+    enum Subsystem {
+        SYSTEM,         // rows of the systems (including partitions/copies)
+        LP,             // LP backend (GLPK problem object)
+        CANDIDATES,     // candidate lists and buffers of elimination steps
+        IO,             // input lines
+        NUM_SUBSYSTEMS
+    };
+
+    const char* subsystem_name(Subsystem s);
+
+    struct Usage
+    {
+        size_t peak[NUM_SUBSYSTEMS] = {};
+        size_t peak_total = 0;      // of the sum over the subsystems
+        size_t peak_rss = 0;        // of the process (bytes)
+    };
+
+    // Set the current usage of a subsystem (bytes), updating the peaks:
+    void record(Subsystem s, size_t bytes);
+    size_t current(Subsystem s);
+    size_t current_total();
+
+    // Peaks of the whole run and of the current period:
+    Usage peak();
+    Usage period_peak();
+
+    // Start a new period, returning the peaks of the previous one:
+    Usage start_period();
+
+    // Resident set size of the process (bytes):
+    size_t current_rss();
+    size_t peak_rss();
+
+    // e.g. "12.3M"
+    std::string format(size_t bytes);
+    // e.g. "rss 40.1M, system 12.3M, lp 20.0M, candidates 1.5M, io 2.0M"
+    std::string summary(const Usage& u);
+
+}
+
+#endif  // include guard
@@ -1,30 +1,171 @@
-// - initialize a system of 2*W random variables with elemental inequalities
-// - treat this system as a two layered periodic CCA of width W and add the
-//   corresponding causal constraints
-// - set the first layer to be mutual independent
-// - minimize the system of inequalites
-// - print all vectors to STDOUT
+// - read a system of inequalities from STDIN
+// - remove all redundant inequalities, testing rows in the order given by
+//   --order=ORDER (reverse, densest, largest, random, learned or all)
+// - print the minimized system to STDOUT
+//
+// With --order=all every strategy is run on a copy of the system and the
+// timings are compared on STDERR.
+//
+// With --symmetry the column permutations (induced by permutations of the
+// random variables) that leave the system invariant are detected and only
+// one row per orbit is tested.
+//
+// With --reduce the implicit equalities (inequalities that are tight on the
+// whole cone) are detected first and not tested individually.
+//
+// With --learn=FILE the rows found redundant in previous runs are read from
+// FILE (and tested first when using --order=learned), and the redundant rows
+// of this run are added to FILE afterwards.
+//
+// Results are looked up in and stored to the result cache (see cache.h,
+// --cache=DIR, --no-cache), except with --order=all and --learn.
+//
+// The input can be in text or binary form (see sysfile.h). The output is
+// written in binary form with --binary, as text without padding with
+// --compact, or as sparse col:coef text with --sparse.
 
 #include <cstdlib>      // atol
+#include <fstream>
+#include <iomanip>      // setw
 #include <iostream>
+#include <iterator>     // begin, end
+#include <set>
+#include <vector>
 #include "fm.h"
+#include "cache.h"
+#include "sysfile.h"
+#include "symmetry.h"
 
 #include "util.h"
 
 
+using namespace std;
+
+
+typedef vector<fm::Value> Row;
+
+Row row_key(const fm::Vector& v)
+{
+    return Row(begin(v.values), end(v.values));
+}
+
+// rows of orig that are not in result (looked up in a sorted set, so that
+// the write-back stays cheap for large systems)
+fm::Matrix removed_rows(const fm::Matrix& orig, const fm::Matrix& result)
+{
+    set<Row> kept;
+    for (auto&& v : result) {
+        kept.insert(row_key(v));
+    }
+    fm::Matrix r;
+    for (auto&& v : orig) {
+        if (kept.find(row_key(v)) == kept.end()) {
+            r.push_back(v.copy());
+        }
+    }
+    return r;
+}
+
 
 int main(int argc, char** argv, char** env)
 try
 {
-    using namespace std;
+    util::Args args(argc, argv);
 
-    fm::System system = fm::parse_matrix(util::read_file(cin));
+    fm::System system = fm::read_system(cin);
 
     util::AutogenNotice gen(argc, argv);
-    fm::minimize{system}.run(fm::MinimizeStatusOutput(&cerr));
 
-    cout << gen.str() << endl;
-    cout << system << endl;
+    string order = args.get("order", "reverse");
+    string learn = args.get("learn");
+
+    fm::Cache cache(args);
+    string cache_key;
+    if (order != "all" && learn.empty()) {
+        cache_key = cache.key(fm::Cache::operation("minimize", args, {
+                "order", "symmetry", "reduce"}), &system);
+    }
+    string cached_header;
+    if (!cache_key.empty() && cache.load(cache_key, system, &cached_header)) {
+        cerr << "Using cached result (" << system.ineqs.size()
+            << " inequalities)" << endl;
+        fm::write_system(cout, system, gen.str() + "\n#\n" + cached_header,
+                         fm::output_format(args));
+        return 0;
+    }
+
+    fm::Matrix learned;
+    if (!learn.empty() && ifstream(learn)) {
+        learned = fm::read_matrix(learn);
+    }
+
+    fm::Group group;
+    if (args.has("symmetry")) {
+        system.split_equalities();
+        group = fm::symmetry_group(system.ineqs);
+        cerr << "Symmetry group of order " << group.order << endl;
+    }
+
+    if (args.has("reduce")) {
+        system.find_equalities();
+        size_t num = system.find_implicit_equalities();
+        cerr << "Implicit equalities: " << num
+            << " (total " << system.eqs.size()
+            << ", dimension " << system.dimension() << ")" << endl;
+    }
+
+    vector<fm::minimize::Order> orders;
+    if (order == "all") {
+        for (int i = 0; i <= fm::minimize::LEARNED; ++i) {
+            orders.push_back(fm::minimize::Order(i));
+        }
+    }
+    else {
+        orders.push_back(fm::parse_order(order));
+    }
+
+    fm::System result(0, system.num_cols);
+    vector<string> timings;
+    for (auto o : orders) {
+        fm::System s = system.copy();
+        boost::timer::cpu_timer timer;
+        fm::minimize{s, o, &learned, 0, fm::nontrivial(group)}.run(
+                fm::MinimizeStatusOutput(&cerr));
+        timings.push_back(util::sprint_all(
+                    setw(10), fm::order_name(o),
+                    setw(8), s.ineqs.size(),
+                    "  ", timer.format(3, "%ws wall, %ts CPU")));
+        result = move(s);
+    }
+
+    if (orders.size() > 1) {
+        cerr << "\n" << setw(10) << "order" << setw(8) << "rows" << endl;
+        for (auto&& line : timings) {
+            cerr << line << endl;
+        }
+    }
+
+    // (the rows learned in previous runs are kept in the file)
+    if (!learn.empty()) {
+        set<Row> seen;
+        ofstream out(learn);
+        for (auto&& v : learned) {
+            if (seen.insert(row_key(v)).second) {
+                out << v << '\n';
+            }
+        }
+        for (auto&& v : removed_rows(system.ineqs, result.ineqs)) {
+            if (seen.insert(row_key(v)).second) {
+                out << v << '\n';
+            }
+        }
+    }
+
+    if (!cache_key.empty()) {
+        cache.store(cache_key, result, gen.str() + "\n");
+    }
+    fm::write_system(cout, result, gen.str() + "\n",
+                     fm::output_format(args));
 }
 catch (...)
 {
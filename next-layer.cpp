@@ -3,11 +3,17 @@
 //   corresponding causal constraints
 // - read from STDIN additional constraints for the first layer
 // - minimize the system of inequalites
-// - print all vectors to STDOUT
+// - print all vectors to STDOUT (see sysfile.h for --compact, --sparse
+//   and --binary)
+//
+// The result is looked up in and stored to the result cache (see cache.h,
+// --cache=DIR, --no-cache).
 
 #include <cstdlib>      // atol
 #include <iostream>
 #include "fm.h"
+#include "cache.h"
+#include "sysfile.h"
 
 #include "util.h"
 
@@ -24,28 +30,45 @@ int usage(int argc, char** argv)
 int main(int argc, char** argv, char** env)
 try
 {
-    if (argc < 2 || argc > 4) {
+    util::Args args(argc, argv);
+    auto& pos = args.pos;
+    if (pos.size() < 1 || pos.size() > 3) {
         return usage(argc, argv);
     }
 
-    size_t nf = atol(argv[1]);                  // num vars in final layer
-    size_t nl = argc >= 3 ? atol(argv[2]) : 2;  // num links for each variable
-    size_t ni = argc >= 4 ? atol(argv[3]) : nf; // num vars in initial layer
+    // num vars in final layer, num links for each variable, num vars in
+    // initial layer:
+    size_t nf = atol(pos[0].c_str());
+    size_t nl = pos.size() >= 2 ? atol(pos[1].c_str()) : 2;
+    size_t ni = pos.size() >= 3 ? atol(pos[2].c_str()) : nf;
     size_t num_vars = nf + ni;
 
     util::AutogenNotice gen(argc, argv);
 
-    fm::System system = fm::elemental_inequalities(num_vars);
+    fm::System input(fm::read_matrix(cin));
+
+    fm::Cache cache(args);
+    string cache_key = cache.key(util::join(" ", "next-layer", nf, nl, ni),
+                                 &input);
+    fm::System system(0, 0);
+    string cached_header;
+    if (cache.load(cache_key, system, &cached_header)) {
+        fm::write_system(cout, system, gen.str() + "\n#\n" + cached_header,
+                         fm::output_format(args));
+        return 0;
+    }
+
+    system = fm::elemental_inequalities(num_vars);
     fm::add_causal_constraints(system, nf, ni, nl);
 
-    for (auto&& constraint : fm::parse_matrix(util::read_file(cin))) {
-        system.add_inequality(constraint.injection(system.num_cols, num_vars));
+    for (auto&& constraint : input.ineqs) {
+        system.add_inequality(constraint.injection(system.num_cols, nf));
     }
 
     fm::minimize{system}.run(fm::MinimizeStatusOutput(&cerr));
 
-    cout << gen.str() << endl;
-    cout << system << endl;
+    cache.store(cache_key, system, gen.str() + "\n");
+    fm::write_system(cout, system, gen.str() + "\n", fm::output_format(args));
     return 0;
 }
 catch (...)
@@ -2,6 +2,7 @@
 #define __NUMBER_H__INCLUDED__
 
 # include <cstddef>
+# include <stdexcept>   // overflow_error
 
 
 // Shift bits such that the given bit is free.
@@ -69,6 +70,26 @@ Int gcd(Int a, Int b)
 }
 
 
+// Integer type that can hold the product of two values of type Int
+// (plus a bit of headroom for sums of such products).
+template <class Int> struct widen { typedef long long type; };
+template <> struct widen<long> { typedef __int128 type; };
+template <> struct widen<long long> { typedef __int128 type; };
+
+
+// Convert to a narrower integer type, checking that the value fits.
+template <class Int, class Wide>
+Int narrow(Wide a)
+{
+    Int r = Int(a);
+    if (Wide(r) != a) {
+        throw std::overflow_error(
+                "Integer overflow: coefficient exceeds the value type.");
+    }
+    return r;
+}
+
+
 // https://graphics.stanford.edu/~seander/bithacks.html#DetermineIfPowerOf2
 template <class Int>
 bool is_power_of_2(Int num)
@@ -0,0 +1,814 @@
+// Python bindings for fm::System and the elimination engine, build with
+//
+//      make python
+//
+// and put python/ on the PYTHONPATH. Example:
+//
+//      import numpy, cfme
+//      s = cfme.elemental_inequalities(4)
+//      s.solve_to(4)                   # project onto the first 4 columns
+//      a = numpy.asarray(s.ineqs())    # (num_ineqs, num_cols) int array
+//      s.problem().is_redundant(a[0])
+//
+// Rows are exchanged through the buffer protocol, so numpy is not needed
+// (array.array, memoryview or any other exporter of signed integers work as
+// well). ineqs() and eqs() pack the rows into one contiguous block that the
+// returned object exports directly, i.e. numpy.asarray does not copy it
+// again. Input buffers are read in place, with arbitrary strides.
+//
+// The GIL is released during solve_to, eliminate and minimize, so other
+// Python threads keep running. A system can only be used by one of these
+// calls at a time (others raise RuntimeError meanwhile).
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cmath>            // floor
+#include <cstring>          // memcpy
+#include <exception>        // exception_ptr
+#include <limits>           // numeric_limits
+#include <new>              // placement new
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../fm.h"
+#include "../number.h"      // narrow
+#include "../symmetry.h"
+
+using namespace std;
+
+
+// Translate C++ exceptions into Python exceptions:
+#define CATCH_ALL(ret)                                              \
+    catch (const overflow_error& e) {                               \
+        PyErr_SetString(PyExc_OverflowError, e.what());             \
+        return ret;                                                 \
+    }                                                               \
+    catch (const invalid_argument& e) {                             \
+        PyErr_SetString(PyExc_ValueError, e.what());                \
+        return ret;                                                 \
+    }                                                               \
+    catch (const bad_alloc&) {                                      \
+        PyErr_NoMemory();                                           \
+        return ret;                                                 \
+    }                                                               \
+    catch (const exception& e) {                                    \
+        PyErr_SetString(PyExc_RuntimeError, e.what());              \
+        return ret;                                                 \
+    }
+
+// Release the GIL for the lifetime of the object. Exceptions are caught
+// while it is released and only translated once it is held again.
+class NoGIL
+{
+    PyThreadState* state;
+public:
+    NoGIL() : state(PyEval_SaveThread()) {}
+    ~NoGIL() { PyEval_RestoreThread(state); }
+};
+
+
+//----------------------------------------
+// Buffer access
+//----------------------------------------
+
+// struct format character of fm::Value
+static const char* value_format()
+{
+    switch (sizeof(fm::Value)) {
+        case 1: return "b";
+        case 2: return "h";
+        case 4: return "i";
+        default: return "q";
+    }
+}
+
+// Read element i of a buffer (native formats only):
+static double buffer_item(const char* p, char f)
+{
+    switch (f) {
+        case 'b': return *(const signed char*) p;
+        case 'B': return *(const unsigned char*) p;
+        case 'h': return *(const short*) p;
+        case 'H': return *(const unsigned short*) p;
+        case 'i': return *(const int*) p;
+        case 'I': return *(const unsigned int*) p;
+        case 'l': return *(const long*) p;
+        case 'L': return *(const unsigned long*) p;
+        case 'q': return *(const long long*) p;
+        case 'Q': return *(const unsigned long long*) p;
+        case 'f': return *(const float*) p;
+        case 'd': return *(const double*) p;
+    }
+    throw invalid_argument(string("Unsupported buffer format: ") + f);
+}
+
+static const char* overflow_message =
+    "Integer overflow: coefficient exceeds the value type.";
+
+// (narrow alone would let unsigned values above the maximum through, as
+// they wrap around to negative values that convert back exactly)
+static fm::Value to_value(unsigned long long x)
+{
+    if (x > (unsigned long long) numeric_limits<fm::Value>::max()) {
+        throw overflow_error(overflow_message);
+    }
+    return fm::Value(x);
+}
+
+static fm::Value to_value(const char* p, char f)
+{
+    switch (f) {
+        case 'l': return narrow<fm::Value>(*(const long*) p);
+        case 'q': return narrow<fm::Value>(*(const long long*) p);
+        case 'L': return to_value(*(const unsigned long*) p);
+        case 'Q': return to_value(*(const unsigned long long*) p);
+    }
+    double x = buffer_item(p, f);
+    if (x != floor(x)) {
+        throw invalid_argument("Coefficients must be integers.");
+    }
+    // (the range is checked before the conversion, which is undefined
+    // for infinities and values beyond the integer type; the bounds are
+    // exact powers of two)
+    const double lim = -double(numeric_limits<fm::Value>::lowest());
+    if (!(x >= -lim && x < lim)) {
+        throw overflow_error(overflow_message);
+    }
+    return fm::Value(x);
+}
+
+// Owns a buffer view of an arbitrary exporter, as 1D or 2D array:
+class View
+{
+    Py_buffer view;
+    bool ok;
+public:
+    char format;
+    Py_ssize_t rows, cols;
+
+    explicit View(PyObject* obj)
+    {
+        ok = PyObject_GetBuffer(obj, &view, PyBUF_RECORDS_RO) == 0;
+        if (!ok) {
+            return;
+        }
+        const char* f = view.format ? view.format : "B";
+        if (*f == '@' || *f == '=') {
+            ++f;
+        }
+        if (view.ndim < 1 || view.ndim > 2 || !f[0] || f[1]) {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError,
+                            "Expected a 1D or 2D array of numbers.");
+            ok = false;
+            return;
+        }
+        format = *f;
+        rows = view.ndim == 2 ? view.shape[0] : 1;
+        cols = view.shape[view.ndim-1];
+    }
+
+    ~View() { if (ok) PyBuffer_Release(&view); }
+
+    explicit operator bool() const { return ok; }
+
+    const char* item(Py_ssize_t i, Py_ssize_t j) const
+    {
+        const char* p = (const char*) view.buf;
+        if (view.ndim == 2) {
+            return p + i*view.strides[0] + j*view.strides[1];
+        }
+        return p + j*view.strides[0];
+    }
+
+    fm::Vector row(Py_ssize_t i) const
+    {
+        fm::Vector v(cols);
+        for (Py_ssize_t j = 0; j < cols; ++j) {
+            v.values[j] = to_value(item(i, j), format);
+        }
+        return v;
+    }
+};
+
+
+//----------------------------------------
+// Rows: contiguous copy of a block of rows
+//----------------------------------------
+
+struct RowsObject
+{
+    PyObject_HEAD
+    vector<fm::Value> data;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+};
+
+static void Rows_dealloc(RowsObject* self)
+{
+    self->data.~vector();
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static int Rows_getbuffer(RowsObject* self, Py_buffer* view, int flags)
+{
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "Rows are read-only.");
+        view->obj = nullptr;
+        return -1;
+    }
+    view->obj = (PyObject*) self;
+    Py_INCREF(self);
+    view->buf = self->data.data();
+    view->len = self->data.size() * sizeof(fm::Value);
+    view->readonly = 1;
+    view->itemsize = sizeof(fm::Value);
+    view->format = (flags & PyBUF_FORMAT) ? (char*) value_format() : nullptr;
+    // (without PyBUF_ND, consumers see the rows as one block of bytes)
+    view->ndim = (flags & PyBUF_ND) ? 2 : 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) ? self->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static PyObject* Rows_shape(RowsObject* self, void*)
+{
+    return Py_BuildValue("(nn)", self->shape[0], self->shape[1]);
+}
+
+static PyObject* Rows_tolist(RowsObject* self, PyObject*)
+{
+    PyObject* list = PyList_New(self->shape[0]);
+    if (!list) {
+        return nullptr;
+    }
+    const fm::Value* p = self->data.data();
+    for (Py_ssize_t i = 0; i < self->shape[0]; ++i) {
+        PyObject* row = PyList_New(self->shape[1]);
+        if (!row) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        for (Py_ssize_t j = 0; j < self->shape[1]; ++j) {
+            PyList_SET_ITEM(row, j, PyLong_FromLongLong(*p++));
+        }
+        PyList_SET_ITEM(list, i, row);
+    }
+    return list;
+}
+
+static Py_ssize_t Rows_length(RowsObject* self)
+{
+    return self->shape[0];
+}
+
+static PyBufferProcs Rows_as_buffer = {
+    (getbufferproc) Rows_getbuffer,
+    nullptr,
+};
+
+static PySequenceMethods Rows_as_sequence = {
+    (lenfunc) Rows_length,
+};
+
+static PyGetSetDef Rows_getset[] = {
+    {"shape", (getter) Rows_shape, nullptr, "(rows, cols)", nullptr},
+    {nullptr},
+};
+
+static PyMethodDef Rows_methods[] = {
+    {"tolist", (PyCFunction) Rows_tolist, METH_NOARGS,
+     "Rows as list of lists."},
+    {nullptr},
+};
+
+static PyTypeObject RowsType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+};
+
+static PyObject* make_rows(const fm::Matrix& m, size_t num_cols)
+{
+    RowsObject* self = PyObject_New(RowsObject, &RowsType);
+    if (!self) {
+        return nullptr;
+    }
+    new (&self->data) vector<fm::Value>();
+    try {
+        self->data.resize(m.size() * num_cols);
+        fm::Value* p = self->data.data();
+        for (auto&& v : m) {
+            if (num_cols == 0) {
+                break;
+            }
+            memcpy(p, &v.values[0], num_cols * sizeof(fm::Value));
+            p += num_cols;
+        }
+    }
+    catch (const bad_alloc&) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    self->shape[0] = m.size();
+    self->shape[1] = num_cols;
+    self->strides[0] = num_cols * sizeof(fm::Value);
+    self->strides[1] = sizeof(fm::Value);
+    return (PyObject*) self;
+}
+
+
+//----------------------------------------
+// Problem
+//----------------------------------------
+
+struct ProblemObject
+{
+    PyObject_HEAD
+    fm::Problem lp;
+};
+
+static PyTypeObject ProblemType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+};
+
+static void Problem_dealloc(ProblemObject* self)
+{
+    self->lp.~Problem();
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static PyObject* make_problem(fm::Problem&& lp)
+{
+    ProblemObject* self = PyObject_New(ProblemObject, &ProblemType);
+    if (!self) {
+        return nullptr;
+    }
+    new (&self->lp) fm::Problem(move(lp));
+    return (PyObject*) self;
+}
+
+static PyObject* Problem_is_redundant(ProblemObject* self, PyObject* arg)
+{
+    View view(arg);
+    if (!view) {
+        return nullptr;
+    }
+    try {
+        if (view.rows != 1 || size_t(view.cols) != self->lp.num_cols) {
+            throw invalid_argument("Row size does not match the problem.");
+        }
+        lp::Vector v(view.cols);
+        for (Py_ssize_t j = 0; j < view.cols; ++j) {
+            v[j] = buffer_item(view.item(0, j), view.format);
+        }
+        return PyBool_FromLong(self->lp.is_redundant(v));
+    }
+    CATCH_ALL(nullptr)
+}
+
+static PyObject* Problem_num_cols(ProblemObject* self, void*)
+{
+    return PyLong_FromSize_t(self->lp.num_cols);
+}
+
+static PyMethodDef Problem_methods[] = {
+    {"is_redundant", (PyCFunction) Problem_is_redundant, METH_O,
+     "is_redundant(row) -> bool\n\n"
+     "Check whether row*x >= 0 is implied by the constraints."},
+    {nullptr},
+};
+
+static PyGetSetDef Problem_getset[] = {
+    {"num_cols", (getter) Problem_num_cols, nullptr, nullptr, nullptr},
+    {nullptr},
+};
+
+
+//----------------------------------------
+// System
+//----------------------------------------
+
+struct SystemObject
+{
+    PyObject_HEAD
+    fm::System sys;
+    bool busy;              // used by a call without the GIL
+};
+
+static PyTypeObject SystemType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+};
+
+static SystemObject* alloc_system(PyTypeObject* type)
+{
+    SystemObject* self = (SystemObject*) type->tp_alloc(type, 0);
+    if (self) {
+        new (&self->sys) fm::System(0, 0);
+        self->busy = false;
+    }
+    return self;
+}
+
+static PyObject* wrap_system(fm::System&& sys)
+{
+    SystemObject* self = alloc_system(&SystemType);
+    if (self) {
+        self->sys = move(sys);
+    }
+    return (PyObject*) self;
+}
+
+static PyObject* System_new(PyTypeObject* type, PyObject*, PyObject*)
+{
+    return (PyObject*) alloc_system(type);
+}
+
+static void System_dealloc(SystemObject* self)
+{
+    self->sys.~System();
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static bool check_idle(SystemObject* self)
+{
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "System is in use by another thread.");
+        return false;
+    }
+    return true;
+}
+
+// System(ineqs=None, eqs=None, num_cols=None)
+static int System_init(SystemObject* self, PyObject* args, PyObject* kwds)
+{
+    static const char* kwlist[] = {"ineqs", "eqs", "num_cols", nullptr};
+    PyObject* ineqs = Py_None;
+    PyObject* eqs = Py_None;
+    Py_ssize_t num_cols = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOn", (char**) kwlist,
+                                     &ineqs, &eqs, &num_cols)) {
+        return -1;
+    }
+    if (!check_idle(self)) {
+        return -1;
+    }
+    try {
+        fm::System sys(0, num_cols < 0 ? 0 : num_cols);
+        for (int k = 0; k < 2; ++k) {
+            PyObject* obj = k ? eqs : ineqs;
+            if (obj == Py_None) {
+                continue;
+            }
+            View view(obj);
+            if (!view) {
+                return -1;
+            }
+            if (num_cols < 0) {
+                num_cols = sys.num_cols = view.cols;
+            }
+            else if (view.cols != num_cols) {
+                throw invalid_argument("Rows have differing column counts.");
+            }
+            for (Py_ssize_t i = 0; i < view.rows; ++i) {
+                if (k) {
+                    sys.add_equality(view.row(i));
+                }
+                else {
+                    sys.add_inequality(view.row(i));
+                }
+            }
+        }
+        self->sys = move(sys);
+        return 0;
+    }
+    CATCH_ALL(-1)
+}
+
+static PyObject* System_repr(SystemObject* self)
+{
+    return PyUnicode_FromFormat("<cfme.System: %zu ineqs, %zu eqs, %zu cols>",
+                                self->sys.ineqs.size(),
+                                self->sys.eqs.size(),
+                                self->sys.num_cols);
+}
+
+static PyObject* System_ineqs(SystemObject* self, PyObject*)
+{
+    if (!check_idle(self)) {
+        return nullptr;
+    }
+    return make_rows(self->sys.ineqs, self->sys.num_cols);
+}
+
+static PyObject* System_eqs(SystemObject* self, PyObject*)
+{
+    if (!check_idle(self)) {
+        return nullptr;
+    }
+    return make_rows(self->sys.eqs, self->sys.num_cols);
+}
+
+static PyObject* System_copy(SystemObject* self, PyObject*)
+{
+    if (!check_idle(self)) {
+        return nullptr;
+    }
+    try {
+        return wrap_system(self->sys.copy());
+    }
+    CATCH_ALL(nullptr)
+}
+
+static PyObject* System_find_equalities(SystemObject* self, PyObject*)
+{
+    if (!check_idle(self)) {
+        return nullptr;
+    }
+    return PyLong_FromSize_t(self->sys.find_equalities());
+}
+
+static PyObject* System_split_equalities(SystemObject* self, PyObject*)
+{
+    if (!check_idle(self)) {
+        return nullptr;
+    }
+    self->sys.split_equalities();
+    Py_RETURN_NONE;
+}
+
+static PyObject* System_problem(SystemObject* self, PyObject*)
+{
+    if (!check_idle(self)) {
+        return nullptr;
+    }
+    try {
+        return make_problem(self->sys.problem());
+    }
+    CATCH_ALL(nullptr)
+}
+
+// Run `f` on the system without holding the GIL:
+template <class F>
+static PyObject* run_nogil(SystemObject* self, F f)
+{
+    if (!check_idle(self)) {
+        return nullptr;
+    }
+    self->busy = true;
+    exception_ptr error;
+    {
+        NoGIL nogil;
+        try {
+            f(self->sys);
+        }
+        catch (...) {
+            error = current_exception();
+        }
+    }
+    self->busy = false;
+    try {
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+    CATCH_ALL(nullptr)
+    Py_RETURN_NONE;
+}
+
+// solve_to(to, schedule="pos-major", shift=False, minimize_growth=0,
+//          minimize_pn=0, minimize_redundancy=0, minimize_partial=False,
+//          reduce=False, purge=0)
+static PyObject* System_solve_to(SystemObject* self,
+                                 PyObject* args, PyObject* kwds)
+{
+    static const char* kwlist[] = {
+        "to", "schedule", "shift", "minimize_growth", "minimize_pn",
+        "minimize_redundancy", "minimize_partial", "reduce", "purge",
+        nullptr};
+    int to;
+    const char* schedule_name = "pos-major";
+    int shift = 0;
+    fm::MinimizePolicy policy;
+    int partial = 0, reduce = 0;
+    Py_ssize_t purge = 0;
+    if (!PyArg_ParseTupleAndKeywords(
+                args, kwds, "i|spdldppn", (char**) kwlist,
+                &to, &schedule_name, &shift, &policy.growth, &policy.max_pn,
+                &policy.redundancy, &partial, &reduce, &purge)) {
+        return nullptr;
+    }
+    policy.partial = partial;
+    policy.reduce = reduce;
+    fm::eliminate::Schedule schedule;
+    try {
+        schedule = fm::parse_schedule(schedule_name);
+    }
+    CATCH_ALL(nullptr)
+    return run_nogil(self, [&](fm::System& sys) {
+        // (the orbit-wise minimize is only valid for invariant systems,
+        // checked as in the eliminate tool)
+        fm::Group group;
+        if (shift) {
+            fm::Problem lp = sys.problem();
+            sys.split_equalities();
+            group = fm::shift_group(intlog2(sys.num_cols)/2);
+            for (auto&& v : fm::expand(sys.ineqs, group)) {
+                if (!lp.is_redundant(v.values)) {
+                    throw invalid_argument(
+                            "System is not invariant under the shifts.");
+                }
+            }
+        }
+        fm::solve_to{sys, to, policy, schedule, size_t(purge)}.run();
+        fm::Group final_group = fm::restrict_group(group, to);
+        fm::close_rows(sys, final_group);
+        fm::minimize{sys, fm::minimize::REVERSE, nullptr, 0,
+                     fm::nontrivial(final_group)}.run();
+    });
+}
+
+// eliminate(index, schedule="pos-major", purge=0)
+static PyObject* System_eliminate(SystemObject* self,
+                                  PyObject* args, PyObject* kwds)
+{
+    static const char* kwlist[] = {"index", "schedule", "purge", nullptr};
+    int index;
+    const char* schedule_name = "pos-major";
+    Py_ssize_t purge = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|sn", (char**) kwlist,
+                                     &index, &schedule_name, &purge)) {
+        return nullptr;
+    }
+    if (index < 0 || size_t(index) >= self->sys.num_cols) {
+        PyErr_SetString(PyExc_IndexError, "Column index out of range.");
+        return nullptr;
+    }
+    fm::eliminate::Schedule schedule;
+    try {
+        schedule = fm::parse_schedule(schedule_name);
+    }
+    CATCH_ALL(nullptr)
+    return run_nogil(self, [&](fm::System& sys) {
+        fm::eliminate{sys, index, schedule, size_t(purge)}.run();
+    });
+}
+
+// minimize(order="reverse")
+static PyObject* System_minimize(SystemObject* self,
+                                 PyObject* args, PyObject* kwds)
+{
+    static const char* kwlist[] = {"order", nullptr};
+    const char* order_name = "reverse";
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|s", (char**) kwlist,
+                                     &order_name)) {
+        return nullptr;
+    }
+    fm::minimize::Order order;
+    try {
+        order = fm::parse_order(order_name);
+    }
+    CATCH_ALL(nullptr)
+    return run_nogil(self, [&](fm::System& sys) {
+        fm::minimize{sys, order}.run();
+    });
+}
+
+static PyObject* System_num_cols(SystemObject* self, void*)
+{
+    return PyLong_FromSize_t(self->sys.num_cols);
+}
+
+static PyObject* System_num_ineqs(SystemObject* self, void*)
+{
+    return PyLong_FromSize_t(self->sys.ineqs.size());
+}
+
+static PyObject* System_num_eqs(SystemObject* self, void*)
+{
+    return PyLong_FromSize_t(self->sys.eqs.size());
+}
+
+static PyMethodDef System_methods[] = {
+    {"ineqs", (PyCFunction) System_ineqs, METH_NOARGS,
+     "Inequality rows (v*x >= 0) as read-only 2D buffer."},
+    {"eqs", (PyCFunction) System_eqs, METH_NOARGS,
+     "Equality rows (v*x == 0) as read-only 2D buffer."},
+    {"copy", (PyCFunction) System_copy, METH_NOARGS, nullptr},
+    {"find_equalities", (PyCFunction) System_find_equalities, METH_NOARGS,
+     "Move pairs of opposite inequalities into the equalities."},
+    {"split_equalities", (PyCFunction) System_split_equalities, METH_NOARGS,
+     "Store each equality as two opposite inequalities."},
+    {"problem", (PyCFunction) System_problem, METH_NOARGS,
+     "LP over the rows of the system."},
+    {"solve_to", (PyCFunction) System_solve_to, METH_VARARGS|METH_KEYWORDS,
+     "solve_to(to, schedule='pos-major', shift=False, minimize_growth=0,\n"
+     "         minimize_pn=0, minimize_redundancy=0,\n"
+     "         minimize_partial=False, reduce=False, purge=0)\n\n"
+     "Eliminate all but the first `to` columns and minimize (see the\n"
+     "eliminate tool). With `shift`, raises ValueError unless the system\n"
+     "is invariant under the shifts of a two-layer CCA."},
+    {"eliminate", (PyCFunction) System_eliminate, METH_VARARGS|METH_KEYWORDS,
+     "eliminate(index, schedule='pos-major', purge=0)\n\n"
+     "Eliminate a single column."},
+    {"minimize", (PyCFunction) System_minimize, METH_VARARGS|METH_KEYWORDS,
+     "minimize(order='reverse')\n\n"
+     "Remove redundant inequalities."},
+    {nullptr},
+};
+
+static PyGetSetDef System_getset[] = {
+    {"num_cols", (getter) System_num_cols, nullptr, nullptr, nullptr},
+    {"num_ineqs", (getter) System_num_ineqs, nullptr, nullptr, nullptr},
+    {"num_eqs", (getter) System_num_eqs, nullptr, nullptr, nullptr},
+    {nullptr},
+};
+
+
+//----------------------------------------
+// Module
+//----------------------------------------
+
+static PyObject* elemental_inequalities(PyObject*, PyObject* arg)
+{
+    long num_vars = PyLong_AsLong(arg);
+    if (num_vars == -1 && PyErr_Occurred()) {
+        return nullptr;
+    }
+    if (num_vars < 0 || num_vars > 30) {
+        PyErr_SetString(PyExc_ValueError, "Invalid number of variables.");
+        return nullptr;
+    }
+    try {
+        return wrap_system(fm::elemental_inequalities(num_vars));
+    }
+    CATCH_ALL(nullptr)
+}
+
+static PyMethodDef module_methods[] = {
+    {"elemental_inequalities", elemental_inequalities, METH_O,
+     "elemental_inequalities(num_vars) -> System"},
+    {nullptr},
+};
+
+static PyModuleDef module_def = {
+    PyModuleDef_HEAD_INIT,
+    "cfme",
+    "Fourier-Motzkin elimination for entropy cones.",
+    -1,
+    module_methods,
+};
+
+PyMODINIT_FUNC PyInit_cfme()
+{
+    RowsType.tp_name = "cfme.Rows";
+    RowsType.tp_basicsize = sizeof(RowsObject);
+    RowsType.tp_dealloc = (destructor) Rows_dealloc;
+    RowsType.tp_as_buffer = &Rows_as_buffer;
+    RowsType.tp_as_sequence = &Rows_as_sequence;
+    RowsType.tp_getset = Rows_getset;
+    RowsType.tp_methods = Rows_methods;
+    RowsType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RowsType.tp_doc = "Contiguous block of rows (buffer protocol).";
+
+    ProblemType.tp_name = "cfme.Problem";
+    ProblemType.tp_basicsize = sizeof(ProblemObject);
+    ProblemType.tp_dealloc = (destructor) Problem_dealloc;
+    ProblemType.tp_methods = Problem_methods;
+    ProblemType.tp_getset = Problem_getset;
+    ProblemType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ProblemType.tp_doc = "LP for redundancy checks.";
+
+    SystemType.tp_name = "cfme.System";
+    SystemType.tp_basicsize = sizeof(SystemObject);
+    SystemType.tp_dealloc = (destructor) System_dealloc;
+    SystemType.tp_repr = (reprfunc) System_repr;
+    SystemType.tp_methods = System_methods;
+    SystemType.tp_getset = System_getset;
+    SystemType.tp_init = (initproc) System_init;
+    SystemType.tp_new = System_new;
+    SystemType.tp_flags = Py_TPFLAGS_DEFAULT;
+    SystemType.tp_doc =
+        "System(ineqs=None, eqs=None, num_cols=None)\n\n"
+        "System of linear inequalities v*x >= 0 and equalities v*x == 0.";
+
+    if (PyType_Ready(&RowsType) < 0 ||
+            PyType_Ready(&ProblemType) < 0 ||
+            PyType_Ready(&SystemType) < 0) {
+        return nullptr;
+    }
+    PyObject* m = PyModule_Create(&module_def);
+    if (!m) {
+        return nullptr;
+    }
+    Py_INCREF(&SystemType);
+    PyModule_AddObject(m, "System", (PyObject*) &SystemType);
+    Py_INCREF(&ProblemType);
+    PyModule_AddObject(m, "Problem", (PyObject*) &ProblemType);
+    Py_INCREF(&RowsType);
+    PyModule_AddObject(m, "Rows", (PyObject*) &RowsType);
+    return m;
+}
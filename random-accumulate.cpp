@@ -16,68 +16,16 @@
 #include <boost/timer/timer.hpp>
 #include <boost/chrono/chrono.hpp>
 
+#include "cancel.h"
 #include "fm.h"
+#include "sysfile.h"
 #include "util.h"
 #include "number.h"
 
 using namespace std;
 
 
-struct timeout_error : public std::runtime_error
-{
-    using runtime_error::runtime_error;
-};
-
-
-using boost::chrono::nanoseconds;
 typedef boost::chrono::duration<double> seconds;
-using boost::timer::cpu_timer;
-
-
-struct Timeout
-{
-    cpu_timer timer;
-    seconds limit;
-
-    Timeout(seconds l)
-        : limit(l)
-    {
-    }
-
-    seconds elapsed() const
-    {
-        auto elapsed = timer.elapsed();
-        return nanoseconds(elapsed.user + elapsed.system);
-    }
-
-    bool operator() () const
-    {
-        return elapsed() > limit;
-    }
-};
-
-
-struct SolveToTimelimit : fm::SolveToStatusOutput
-{
-    Timeout timeout;
-
-    typedef fm::SolveToStatusOutput super;
-
-    SolveToTimelimit(const fm::IO& io, seconds timelimit)
-        : super(io)
-        , timeout(timelimit)
-    {
-    }
-
-    fm::SG start_step(int step) const                   override
-    {
-        if (timeout()) {
-            throw timeout_error("Running out of time.");
-        }
-        return super::start_step(step);
-    }
-    
-};
 
 
 fm::Matrix random_elimination(fm::System system, int num_drop,
@@ -96,7 +44,14 @@ fm::Matrix random_elimination(fm::System system, int num_drop,
         matrix.erase(matrix.begin() + index);
     }
 
-    fm::solve_to{system, solve_to}.run(SolveToTimelimit(io, timelimit));
+    // (when running out of time, the rows found so far are kept)
+    fm::CancelToken cancel;
+    cancel.max_cpu = timelimit.count();
+    fm::IO status = io;
+    status.cancel = &cancel;
+    fm::solve_to elim{system, solve_to};
+    elim.cancel = &cancel;
+    elim.run(fm::SolveToStatusOutput(status));
     fm::minimize{system}.run(fm::MinimizeStatusOutput(io));
     return move(system.ineqs);
 }
@@ -139,17 +94,16 @@ try
     fm::IO io(&cerr);
 
     int num_drop = atol(argv[1]);;
-    fm::System init_state = fm::parse_matrix(util::read_file(argv[2]));
+    fm::System init_state = fm::read_system(argv[2]);
     seconds timelimit(5*60);
 
     fm::Matrix result = random_elimination(move(init_state), num_drop,
                                            timelimit, io);
-    fm::System accum = fm::parse_matrix(util::read_file(argv[3]));
+    fm::System accum = fm::read_system(argv[3]);
     merge(accum, result, io);
 
     ofstream out(argv[3]);
-    out << gen.str() << endl;
-    out << accum << endl;
+    fm::write_system(out, accum, gen.str() + "\n");
 
     return 0;
 }
@@ -17,19 +17,15 @@
 #include <boost/timer/timer.hpp>
 #include <boost/chrono/chrono.hpp>
 
+#include "cancel.h"
 #include "fm.h"
+#include "sysfile.h"
 #include "util.h"
 #include "number.h"
 
 using namespace std;
 
 
-struct timeout_error : public std::runtime_error
-{
-    using runtime_error::runtime_error;
-};
-
-
 using boost::chrono::nanoseconds;
 typedef boost::chrono::duration<double> seconds;
 using boost::timer::cpu_timer;
@@ -58,26 +54,8 @@ struct Timeout
 };
 
 
-struct SolveToTimelimit : fm::solve_to::Callback
-{
-    Timeout timeout;
-
-    SolveToTimelimit(seconds timelimit)
-        : timeout(timelimit)
-    {
-    }
-
-    fm::SG start_step(int step) const                   override
-    {
-        if (timeout()) {
-            throw timeout_error("Running out of time.");
-        }
-        return fm::SG();
-    }
-};
-
-
-fm::Matrix random_elimination(fm::System system, int num_drop)
+fm::Matrix random_elimination(fm::System system, int num_drop,
+                              bool& timed_out)
 {
     fm::Matrix& matrix = system.ineqs;
     int num_vars = matrix[0].size();
@@ -92,7 +70,13 @@ fm::Matrix random_elimination(fm::System system, int num_drop)
         matrix.erase(matrix.begin() + index);
     }
 
-    fm::solve_to{system, solve_to}.run(SolveToTimelimit(seconds(30)));
+    // (when running out of time, the rows found so far are kept)
+    fm::CancelToken cancel;
+    cancel.max_cpu = 30;
+    fm::solve_to elim{system, solve_to};
+    elim.cancel = &cancel;
+    elim.run();
+    timed_out = cancel.cancelled();
     fm::minimize{system}.run();
     return move(system.ineqs);
 }
@@ -160,12 +144,9 @@ struct Result
     {
         timeout.timer.start();
         while (!finished && !timeout()) {
-            try {
-                add(random_elimination(init_state.copy(), num_drop));
-            }
-            catch (timeout_error& e) {
-                ++num_timeouts;
-            }
+            bool timed_out;
+            add(random_elimination(init_state.copy(), num_drop, timed_out));
+            num_timeouts += timed_out;
         }
         timeout.timer.stop();
     }
@@ -299,8 +280,8 @@ try
     util::AutogenNotice gen(argc, argv);
 
     int num_drop = atol(argv[1]);;
-    fm::System init_state = fm::parse_matrix(util::read_file(argv[2]));
-    fm::System ref_solution = fm::parse_matrix(util::read_file(argv[3]));
+    fm::System init_state = fm::read_system(argv[2]);
+    fm::System ref_solution = fm::read_system(argv[3]);
     int num_turns = 100;
     seconds timelimit(5*60);
 
@@ -0,0 +1,487 @@
+// Detection and use of column permutations that leave a system of
+// inequalities invariant.
+
+#include <algorithm>    // find
+#include <functional>   // function
+#include <map>
+#include <set>
+#include <utility>      // move
+
+#include "symmetry.h"
+#include "number.h"     // intlog2, is_power_of_2, shifted
+
+
+using std::move;
+using std::vector;
+
+
+namespace fm
+{
+
+typedef vector<Value> Key;
+
+static Key key(const Vector& v)
+{
+    return Key(std::begin(v.values), std::end(v.values));
+}
+
+
+Permutation column_permutation(const vector<int>& var_perm)
+{
+    size_t num_cols = size_t(1) << var_perm.size();
+    Permutation p(num_cols);
+    for (size_t col = 0; col < num_cols; ++col) {
+        size_t img = 0;
+        for (size_t i = 0; i < var_perm.size(); ++i) {
+            if (col & (size_t(1) << i)) {
+                img |= size_t(1) << var_perm[i];
+            }
+        }
+        p[col] = img;
+    }
+    return p;
+}
+
+
+Vector permuted(const Vector& v, const Permutation& p)
+{
+    Vector r(v.size());
+    for (size_t i = 0; i < v.size(); ++i) {
+        r.set(p[i], v.get(i));
+    }
+    return r;
+}
+
+
+Group symmetry_group(const Matrix& m)
+{
+    return symmetry_group(vector<const Matrix*>{&m});
+}
+
+
+// The group is built as a chain of pointwise stabilizers: on level k the
+// variables 0..k-1 are fixed and for every possible image j of variable k
+// one automorphism mapping k to j is searched. These coset representatives
+// form a strong generating set and the group order is the product of the
+// numbers of cosets on each level.
+Group symmetry_group(const vector<const Matrix*>& ms)
+{
+    Group group;
+
+    int num_cols = -1;
+    for (auto m : ms) {
+        int n = get_num_cols(*m);
+        if (n == -1)
+            continue;
+        if (num_cols != -1 && n != num_cols)
+            return group;
+        num_cols = n;
+    }
+    if (num_cols <= 1 || !is_power_of_2(num_cols))
+        return group;
+    int num_vars = intlog2(num_cols);
+
+    // Rows can only be checked once all their variables are assigned, so
+    // they are grouped by the number of variables that must be assigned.
+    // Variables are compared by a simple signature to prune the search.
+    struct Row { const Vector* vec; const std::set<Key>* set; };
+    vector<std::set<Key>> sets(ms.size());
+    vector<vector<Row>> check_at(num_vars+1);
+    vector<std::pair<long, long>> sig(num_vars);
+    for (size_t k = 0; k < ms.size(); ++k) {
+        for (auto&& v : *ms[k]) {
+            sets[k].insert(key(v));
+            size_t mask = 0;
+            for (size_t col = 0; col < v.size(); ++col) {
+                Value val = v.get(col);
+                if (!val)
+                    continue;
+                mask |= col;
+                for (int i = 0; i < num_vars; ++i) {
+                    if (col & (size_t(1) << i)) {
+                        sig[i].first += 1;
+                        sig[i].second += abs(val);
+                    }
+                }
+            }
+            int depth = mask ? intlog2(mask)+1 : 0;
+            check_at[depth].push_back(Row{&v, &sets[k]});
+        }
+    }
+
+    vector<int> perm(num_vars);
+    vector<bool> used(num_vars);
+
+    auto image = [&perm] (size_t col) {
+        size_t img = 0;
+        for (size_t i = 0; col; ++i, col >>= 1) {
+            if (col & 1) {
+                img |= size_t(1) << perm[i];
+            }
+        }
+        return img;
+    };
+
+    auto consistent = [&] (int depth) {
+        for (auto&& row : check_at[depth]) {
+            const Vector& v = *row.vec;
+            Key img(v.size());
+            for (size_t col = 0; col < v.size(); ++col) {
+                if (v.get(col)) {
+                    img[image(col)] = v.get(col);
+                }
+            }
+            if (!row.set->count(img)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::function<bool(int)> extend = [&] (int d) {
+        if (d == num_vars)
+            return true;
+        for (int j = 0; j < num_vars; ++j) {
+            if (used[j] || sig[j] != sig[d])
+                continue;
+            used[j] = true;
+            perm[d] = j;
+            bool found = consistent(d+1) && extend(d+1);
+            used[j] = false;
+            if (found)
+                return true;
+        }
+        return false;
+    };
+
+    for (int k = 0; k < num_vars; ++k) {
+        size_t num_cosets = 1;
+        for (int i = 0; i < k; ++i) {
+            perm[i] = i;
+            used[i] = true;
+        }
+        for (int j = k+1; j < num_vars; ++j) {
+            if (sig[j] != sig[k])
+                continue;
+            used[j] = true;
+            perm[k] = j;
+            if (consistent(k+1) && extend(k+1)) {
+                group.gens.push_back(column_permutation(perm));
+                ++num_cosets;
+            }
+            used[j] = false;
+        }
+        group.order *= num_cosets;
+    }
+    return group;
+}
+
+
+Group shift_group(size_t width)
+{
+    Group group;
+    size_t num_cols = size_t(1) << (2*width);
+    if (width <= 1)
+        return group;
+    Permutation p(num_cols);
+    for (size_t i = 0; i < num_cols; ++i) {
+        p[i] = shifted(i, width, size_t(1));
+    }
+    group.gens.push_back(p);
+    group.order = width;
+    return group;
+}
+
+
+// Pointwise stabilizer chain of a group of variable permutations with the
+// base 0,1,...: entry (i, j) maps i to j and fixes 0..i-1. Every product of
+// two entries is sifted back into the table, which makes each level a full
+// transversal (Knuth's variant of the Schreier-Sims algorithm). The entries
+// form a strong generating set of at most n(n-1)/2 elements, and the group
+// order is the product of the level sizes.
+class StabilizerChain
+{
+    size_t n;
+    vector<vector<Permutation>> table;  // empty if there is no entry
+
+    static Permutation compose(const Permutation& a, const Permutation& b)
+    {
+        Permutation r(b.size());
+        for (size_t i = 0; i < b.size(); ++i) {
+            r[i] = a[b[i]];
+        }
+        return r;
+    }
+
+    static Permutation inverse(const Permutation& a)
+    {
+        Permutation r(a.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            r[a[i]] = i;
+        }
+        return r;
+    }
+
+    // Returns false if the permutation was already in the group
+    bool insert(Permutation g, vector<Permutation>& added)
+    {
+        for (size_t i = 0; i < n; ++i) {
+            size_t j = g[i];
+            if (j == i)
+                continue;
+            if (table[i][j].empty()) {
+                table[i][j] = g;
+                added.push_back(move(g));
+                return true;
+            }
+            g = compose(inverse(table[i][j]), g);
+        }
+        return false;
+    }
+
+public:
+    explicit StabilizerChain(size_t n)
+        : n(n), table(n, vector<Permutation>(n))
+    {
+        Permutation id(n);
+        for (size_t i = 0; i < n; ++i) {
+            id[i] = i;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            table[i][i] = id;
+        }
+    }
+
+    void add(const Permutation& g)
+    {
+        vector<Permutation> queue;
+        insert(g, queue);
+        while (!queue.empty()) {
+            Permutation a = move(queue.back());
+            queue.pop_back();
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t j = i+1; j < n; ++j) {
+                    if (!table[i][j].empty()) {
+                        Permutation b = table[i][j];
+                        insert(compose(a, b), queue);
+                        insert(compose(b, a), queue);
+                    }
+                }
+            }
+        }
+    }
+
+    bool contains(size_t i, size_t j) const
+    {
+        return !table[i][j].empty();
+    }
+
+    const Permutation& get(size_t i, size_t j) const
+    {
+        return table[i][j];
+    }
+
+    double order() const
+    {
+        double order = 1;
+        for (size_t i = 0; i < n; ++i) {
+            size_t num = 0;
+            for (size_t j = 0; j < n; ++j) {
+                num += contains(i, j);
+            }
+            order *= num;
+        }
+        return order;
+    }
+
+    vector<Permutation> generators() const
+    {
+        vector<Permutation> gens;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i+1; j < n; ++j) {
+                if (contains(i, j)) {
+                    gens.push_back(table[i][j]);
+                }
+            }
+        }
+        return gens;
+    }
+};
+
+
+// Image of the column under a permutation of the variables
+static size_t column_image(const Permutation& var_perm, size_t col)
+{
+    size_t img = 0;
+    for (size_t i = 0; col; ++i, col >>= 1) {
+        if (col & 1) {
+            img |= size_t(1) << var_perm[i];
+        }
+    }
+    return img;
+}
+
+
+// The columns 0..keep-1 only involve the variables 0..m-1 (with 2^m >=
+// keep), and an element that preserves them maps these variables onto
+// themselves. The subgroup is searched level by level along the chain of
+// the whole group: an element is determined by the images of 0..m-1, and a
+// column can be checked once the image of its highest variable is known.
+// As in `symmetry_group`, only the elements that fix 0..i-1 and map i to
+// some j are searched for, unless j is already in the orbit of i under the
+// part of the subgroup found so far. This keeps the search small even if
+// the subgroup is huge.
+Group restrict_group(const Group& g, size_t keep)
+{
+    Group r;
+    size_t m = 0;
+    while ((size_t(1) << m) < keep) {
+        ++m;
+    }
+    if (g.gens.empty() || m == 0)
+        return r;
+
+    size_t n = intlog2(g.gens[0].size());
+    StabilizerChain chain(n);
+    for (auto&& p : g.gens) {
+        Permutation var_perm(n);
+        for (size_t i = 0; i < n; ++i) {
+            var_perm[i] = intlog2(p[size_t(1) << i]);
+        }
+        chain.add(var_perm);
+    }
+
+    // check the columns whose highest variable is i:
+    auto preserves = [keep] (const Permutation& p, size_t i) {
+        size_t end = std::min(size_t(2) << i, keep);
+        for (size_t col = size_t(1) << i; col < end; ++col) {
+            if (column_image(p, col) >= keep) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // extend an element that preserves the columns up to level i-1:
+    std::function<bool(size_t, const Permutation&, Permutation&)> extend =
+        [&] (size_t i, const Permutation& p, Permutation& found) {
+            if (i == m) {
+                found = p;
+                return true;
+            }
+            for (size_t j = i; j < n; ++j) {
+                if (!chain.contains(i, j))
+                    continue;
+                Permutation q(n);
+                for (size_t k = 0; k < n; ++k) {
+                    q[k] = p[chain.get(i, j)[k]];
+                }
+                if (preserves(q, i) && extend(i+1, q, found)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+    StabilizerChain sub(m);
+    for (size_t i = m; i-- > 0; ) {
+        for (size_t j = i+1; j < m; ++j) {
+            Permutation found;
+            if (chain.contains(i, j) && !sub.contains(i, j) &&
+                    preserves(chain.get(i, j), i) &&
+                    extend(i+1, chain.get(i, j), found)) {
+                sub.add(Permutation(found.begin(), found.begin() + m));
+            }
+        }
+    }
+
+    for (auto&& var_perm : sub.generators()) {
+        vector<int> vp(var_perm.begin(), var_perm.end());
+        Permutation p = column_permutation(vp);
+        p.resize(keep);
+        r.gens.push_back(move(p));
+    }
+    r.order = sub.order();
+    return r;
+}
+
+
+std::vector<Orbit> row_orbits(const Matrix& m, const Group& g)
+{
+    std::map<Key, size_t> index;
+    for (size_t i = 0; i < m.size(); ++i) {
+        index.insert({key(m[i]), i});
+    }
+
+    // union-find over the row indices
+    vector<size_t> parent(m.size());
+    for (size_t i = 0; i < m.size(); ++i) {
+        parent[i] = i;
+    }
+    std::function<size_t(size_t)> find = [&] (size_t i) {
+        while (parent[i] != i) {
+            i = parent[i] = parent[parent[i]];
+        }
+        return i;
+    };
+
+    for (size_t i = 0; i < m.size(); ++i) {
+        for (auto&& p : g.gens) {
+            auto it = index.find(key(permuted(m[i], p)));
+            _assert(it != index.end(), std::logic_error,
+                    "matrix is not invariant under the group");
+            size_t a = find(i), b = find(it->second);
+            if (a != b) {
+                parent[std::max(a, b)] = std::min(a, b);
+            }
+        }
+    }
+
+    std::vector<Orbit> orbits;
+    std::map<size_t, size_t> orbit_of_root;
+    for (size_t i = 0; i < m.size(); ++i) {
+        size_t root = find(i);
+        auto it = orbit_of_root.find(root);
+        if (it == orbit_of_root.end()) {
+            orbit_of_root[root] = orbits.size();
+            orbits.push_back(Orbit{i});
+        }
+        else {
+            orbits[it->second].push_back(i);
+        }
+    }
+    return orbits;
+}
+
+
+Matrix expand(const Matrix& reps, const Group& g)
+{
+    Matrix r;
+    std::set<Key> seen;
+    for (auto&& rep : reps) {
+        if (!seen.insert(key(rep)).second)
+            continue;
+        size_t begin = r.size();
+        r.push_back(rep.copy());
+        for (size_t i = begin; i < r.size(); ++i) {
+            for (auto&& p : g.gens) {
+                Vector v = permuted(r[i], p);
+                if (seen.insert(key(v)).second) {
+                    r.push_back(move(v));
+                }
+            }
+        }
+    }
+    return r;
+}
+
+
+void close_rows(System& s, const Group& g)
+{
+    if (g.gens.empty())
+        return;
+    s.split_equalities();
+    s.ineqs = expand(s.ineqs, g);
+}
+
+}
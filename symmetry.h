@@ -0,0 +1,80 @@
+// Detection and use of column permutations that leave a system of
+// inequalities invariant.
+//
+// Only column permutations that are induced by permutations of the random
+// variables are considered, i.e. the column with bit representation S is
+// mapped to the column whose bits are the images of the variables in S.
+// This covers the permutation symmetry of entropy cones as well as the
+// cyclic shifts of CCAs.
+//
+// The symmetries are used to minimize and compare systems orbit-wise, not
+// to eliminate columns: a projection along one column is only invariant
+// under the elements that fix that column, which for the cyclic shifts of
+// a CCA is usually just the identity. Only the final projection is
+// invariant under the whole group (see `restrict_group`), so the
+// elimination steps process every row.
+
+#ifndef __SYMMETRY_H__INCLUDED__
+#define __SYMMETRY_H__INCLUDED__
+
+# include <vector>
+
+# include "fm.h"
+
+
+namespace fm
+{
+
+    typedef std::vector<size_t> Permutation;    // column i -> p[i]
+    typedef std::vector<size_t> Orbit;
+
+    // Permutation group given by a set of generators.
+    struct Group
+    {
+        std::vector<Permutation> gens;
+        double order = 1;       // (exceeds the integer types for n > 20)
+    };
+
+    // Pointer to the group, or nullptr if it has no generators (callers
+    // then skip the orbit-wise code paths entirely).
+    inline const Group* nontrivial(const Group& g)
+    {
+        return g.gens.empty() ? nullptr : &g;
+    }
+
+    // Return the column permutation induced by the given permutation of
+    // random variables.
+    Permutation column_permutation(const std::vector<int>& var_perm);
+
+    Vector permuted(const Vector& v, const Permutation& p);
+
+    // Return the group of all column permutations (induced by variable
+    // permutations) that map each of the given sets of rows onto itself.
+    Group symmetry_group(const std::vector<const Matrix*>& ms);
+    Group symmetry_group(const Matrix& m);
+
+    // Return the cyclic group of simultaneous shifts of both layers of a
+    // two-layer CCA of the given width (see `shifted`).
+    Group shift_group(size_t width);
+
+    // Return the subgroup of elements that map the columns 0..keep-1 onto
+    // themselves, acting on these columns only. The generators are a
+    // strong generating set, the group itself is never enumerated.
+    Group restrict_group(const Group& g, size_t keep);
+
+    // Partition the row indices of a `g`-invariant matrix into orbits. The
+    // first index of each orbit is its representative.
+    std::vector<Orbit> row_orbits(const Matrix& m, const Group& g);
+
+    // Return all distinct images of the given rows.
+    Matrix expand(const Matrix& reps, const Group& g);
+
+    // Make the rows of the system closed under the group, by splitting the
+    // equalities and adding all images of the inequalities. This does not
+    // change the solutions if they are invariant, e.g. for the projection
+    // of an invariant system (whose rows are invariant only as a cone).
+    void close_rows(System& s, const Group& g);
+
+}
+
+#endif  // include guard
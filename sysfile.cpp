@@ -0,0 +1,822 @@
+// Text and binary system files, see sysfile.h.
+
+#include <algorithm>    // count, max, min
+#include <climits>      // LLONG_MAX
+#include <cstdlib>      // strtoul
+#include <cstring>      // memcpy, memcmp, memchr
+#include <exception>    // exception_ptr
+#include <fstream>
+#include <functional>
+#include <stdexcept>    // runtime_error
+#include <thread>
+#include <utility>      // move
+
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap, munmap
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close
+
+#include "sysfile.h"
+#include "error.h"      // parse_error
+#include "memory.h"
+#include "number.h"     // narrow
+
+
+namespace fm
+{
+
+    static const char magic[8] = "CFMESYS";
+    static const uint32_t version = 1;
+    static const size_t data_align = 64;
+
+    static size_t align(size_t offset, size_t to)
+    {
+        return (offset + to - 1) / to * to;
+    }
+
+    static bool is_binary(const char* data, size_t size)
+    {
+        return size >= sizeof(magic) &&
+            std::memcmp(data, magic, sizeof(magic)) == 0;
+    }
+
+    template <class Int>
+    static Value get(const char* p)
+    {
+        Int x;
+        std::memcpy(&x, p, sizeof(x));
+        return narrow<Value>(x);
+    }
+
+    static Value get_value(const char* p, size_t value_size)
+    {
+        switch (value_size) {
+            case 1: return get<int8_t>(p);
+            case 2: return get<int16_t>(p);
+            case 4: return get<int32_t>(p);
+            case 8: return get<int64_t>(p);
+        }
+        throw std::runtime_error("Unsupported value size in binary system");
+    }
+
+    // Sizes taken from a (possibly corrupt) header must not wrap around:
+    static uint64_t checked_add(uint64_t a, uint64_t b)
+    {
+        if (a > UINT64_MAX - b) {
+            throw std::runtime_error("Invalid size in binary system");
+        }
+        return a + b;
+    }
+
+    static uint64_t checked_mul(uint64_t a, uint64_t b)
+    {
+        if (b != 0 && a > UINT64_MAX / b) {
+            throw std::runtime_error("Invalid size in binary system");
+        }
+        return a * b;
+    }
+
+    // Decode a binary system from memory (e.g. a mapped file). All offsets
+    // and lengths are checked against `size` before they are used:
+    static System decode(const char* data, size_t size,
+                         std::string* provenance)
+    {
+        BinaryHeader h;
+        if (size < sizeof(h)) {
+            throw std::runtime_error("Truncated binary system header");
+        }
+        std::memcpy(&h, data, sizeof(h));
+        if (h.version != version) {
+            throw std::runtime_error("Unsupported binary system version");
+        }
+        if (h.value_size != 1 && h.value_size != 2 &&
+                h.value_size != 4 && h.value_size != 8) {
+            throw std::runtime_error("Unsupported value size in binary system");
+        }
+        if (checked_add(sizeof(h), h.provenance) > size || h.data > size) {
+            throw std::runtime_error("Truncated binary system");
+        }
+        if (provenance) {
+            *provenance = std::string(data + sizeof(h), h.provenance);
+        }
+
+        uint64_t num_rows = checked_add(h.num_ineqs, h.num_eqs);
+        size_t vs = h.value_size;
+        const char* p = data + h.data;
+        uint64_t avail = size - h.data;     // bytes of row data
+
+        // sparse: row offsets, column indices and values (see sysfile.h)
+        bool sparse = h.flags & BinaryHeader::SPARSE;
+        uint64_t nnz = 0, index_pos = 0, values_pos = 0;
+        if (sparse) {
+            index_pos = checked_mul(checked_add(num_rows, 1), 8);
+            if (index_pos > avail) {
+                throw std::runtime_error("Truncated binary system");
+            }
+            std::memcpy(&nnz, p + num_rows * 8, 8);
+            values_pos = checked_add(
+                    checked_add(index_pos, checked_mul(nnz, 4)), 7) / 8 * 8;
+            if (checked_add(values_pos, checked_mul(nnz, vs)) > avail) {
+                throw std::runtime_error("Truncated binary system");
+            }
+        }
+        else if (checked_mul(checked_mul(num_rows, h.num_cols), vs) > avail) {
+            throw std::runtime_error("Truncated binary system");
+        }
+
+        System s(h.num_ineqs, h.num_cols);
+        auto add_row = [&] (size_t row, Vector&& v) {
+            if (row < h.num_ineqs) {
+                s.add_inequality(std::move(v));
+            }
+            else {
+                s.add_equality(std::move(v));
+            }
+        };
+
+        if (sparse) {
+            const char* offsets = p;
+            const char* index = p + index_pos;
+            const char* values = p + values_pos;
+            uint64_t beg = 0;
+            for (size_t row = 0; row < num_rows; ++row) {
+                uint64_t next;
+                std::memcpy(&next, offsets + (row+1) * 8, 8);
+                if (next < beg || next > nnz) {
+                    throw std::runtime_error(
+                            "Invalid row offset in binary system");
+                }
+                Vector v(h.num_cols);
+                for (uint64_t k = beg; k < next; ++k) {
+                    uint32_t col;
+                    std::memcpy(&col, index + k * 4, 4);
+                    if (col >= h.num_cols) {
+                        throw std::runtime_error(
+                                "Column index out of range in binary system");
+                    }
+                    v.set(col, get_value(values + k * vs, vs));
+                }
+                add_row(row, std::move(v));
+                beg = next;
+            }
+        }
+        else {
+            for (size_t row = 0; row < num_rows; ++row) {
+                Vector v(h.num_cols);
+                for (size_t col = 0; col < h.num_cols; ++col) {
+                    v.set(col, get_value(p, vs));
+                    p += vs;
+                }
+                add_row(row, std::move(v));
+            }
+        }
+        return s;
+    }
+
+    // Text parsing
+    //
+    // The text is parsed in place (from the mapped file or the input
+    // buffer), without splitting it into lines first. Large inputs are
+    // split into line aligned chunks that are parsed concurrently.
+
+    static const size_t min_chunk_size = 4 << 20;
+
+    struct TextChunk
+    {
+        const char* beg;
+        const char* end;
+        size_t first_line;          // 1-based
+        size_t dim;                 // from the header, or 0
+        Matrix rows;
+        size_t dense_cols = 0;      // of the dense rows
+        size_t sparse_cols = 0;     // largest sparse index + 1
+        std::string provenance;
+        std::exception_ptr error;
+    };
+
+    static bool is_blank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static void fail(size_t line, const std::string& what)
+    {
+        throw parse_error("line " + std::to_string(line) + ": " + what);
+    }
+
+    static long long scan_int(const char*& p, const char* eol, size_t line)
+    {
+        bool neg = *p == '-';
+        if (*p == '-' || *p == '+') {
+            ++p;
+        }
+        if (p == eol || *p < '0' || *p > '9') {
+            fail(line, "expecting a number");
+        }
+        long long x = 0;
+        for (; p < eol && *p >= '0' && *p <= '9'; ++p) {
+            int d = *p - '0';
+            if (x > (LLONG_MAX - d) / 10) {
+                fail(line, "value out of range");
+            }
+            x = x * 10 + d;
+        }
+        return neg ? -x : x;
+    }
+
+    static Value to_value(long long x, size_t line)
+    {
+        try {
+            return narrow<Value>(x);
+        }
+        catch (std::overflow_error&) {
+            fail(line, "value out of range");
+        }
+        return 0;
+    }
+
+    static void parse_chunk(TextChunk& chunk)
+    {
+        std::vector<Value> row;
+        std::vector<std::pair<size_t, Value>> sparse;
+        size_t line = chunk.first_line;
+        for (const char* p = chunk.beg; p < chunk.end; ++line) {
+            const char* eol = static_cast<const char*>(
+                    std::memchr(p, '\n', chunk.end - p));
+            if (!eol) {
+                eol = chunk.end;
+            }
+            // (the dimension header is not part of the provenance)
+            bool dim_header = eol - p > 6 && std::memcmp(p, "# dim:", 6) == 0;
+            if (*p == '#' && !dim_header) {
+                chunk.provenance.append(p, eol);
+                chunk.provenance += '\n';
+            }
+            row.clear();
+            sparse.clear();
+            bool bracket = false, closed = false;
+            while (p < eol) {
+                char c = *p;
+                if (is_blank(c)) {
+                    ++p;
+                    continue;
+                }
+                if (c == '#') {
+                    break;
+                }
+                if (closed) {
+                    fail(line, "unexpected input after ']'");
+                }
+                // (backward compatibility for the bracketed form)
+                if (c == '[' && row.empty() && !bracket) {
+                    bracket = true;
+                    ++p;
+                    continue;
+                }
+                if (c == ']' && bracket) {
+                    closed = true;
+                    ++p;
+                    continue;
+                }
+                long long x = scan_int(p, eol, line);
+                if (p < eol && *p == ':') {
+                    ++p;
+                    long long y = scan_int(p, eol, line);
+                    if (x < 0 || (chunk.dim && size_t(x) >= chunk.dim)) {
+                        fail(line, "column out of range");
+                    }
+                    sparse.emplace_back(x, to_value(y, line));
+                }
+                else {
+                    row.push_back(to_value(x, line));
+                }
+                if (p < eol && !is_blank(*p) && *p != '#' && *p != ']') {
+                    fail(line, "expecting a number");
+                }
+            }
+            if (bracket && !closed) {
+                fail(line, "expecting ']'");
+            }
+            if (!row.empty() && !sparse.empty()) {
+                fail(line, "mixed dense and sparse coefficients");
+            }
+            if (!sparse.empty()) {
+                // (without a header, the row ends at the last nonzero and is
+                // padded later)
+                size_t size = chunk.dim;
+                for (auto&& v : sparse) {
+                    chunk.sparse_cols = std::max(chunk.sparse_cols, v.first+1);
+                    size = std::max(size, v.first+1);
+                }
+                Vector v(size);
+                for (auto&& x : sparse) {
+                    v.set(x.first, x.second);
+                }
+                chunk.rows.push_back(std::move(v));
+            }
+            else if (!row.empty()) {
+                size_t expect = chunk.dim ? chunk.dim : chunk.dense_cols;
+                if (expect && row.size() != expect) {
+                    fail(line, "expecting " + std::to_string(expect) +
+                         " columns, got " + std::to_string(row.size()));
+                }
+                chunk.dense_cols = row.size();
+                chunk.rows.push_back(Vector(ValArray(row.data(), row.size())));
+            }
+            p = eol + 1;
+        }
+    }
+
+    // Dimension from a "# dim: N" line in the leading comments (required
+    // only by the sparse rows, see sysfile.h):
+    static size_t parse_dim(const char* p, const char* end)
+    {
+        while (p < end && (*p == '#' || *p == '\n' || is_blank(*p))) {
+            const char* eol = static_cast<const char*>(
+                    std::memchr(p, '\n', end - p));
+            if (!eol) {
+                eol = end;
+            }
+            static const char key[] = "# dim:";
+            if (eol - p > 6 && std::memcmp(p, key, 6) == 0) {
+                return std::strtoul(std::string(p + 6, eol).c_str(),
+                                    nullptr, 10);
+            }
+            p = eol + 1;
+        }
+        return 0;
+    }
+
+    static System parse_text(const char* data, size_t size,
+                             std::string* provenance)
+    {
+        size_t num_chunks = 1;
+        if (size >= 2 * min_chunk_size) {
+            size_t num_threads = std::max(
+                    1u, std::thread::hardware_concurrency());
+            num_chunks = std::min(num_threads, size / min_chunk_size);
+        }
+
+        std::vector<TextChunk> chunks(num_chunks);
+        const char* end = data + size;
+        const char* p = data;
+        size_t dim = parse_dim(data, end);
+        size_t line = 1;
+        for (size_t i = 0; i < num_chunks; ++i) {
+            const char* e = i+1 == num_chunks
+                ? end : data + size*(i+1)/num_chunks;
+            if (e < p) {
+                e = p;
+            }
+            if (e < end) {
+                const char* eol = static_cast<const char*>(
+                        std::memchr(e, '\n', end - e));
+                e = eol ? eol + 1 : end;
+            }
+            chunks[i].beg = p;
+            chunks[i].end = e;
+            chunks[i].first_line = line;
+            chunks[i].dim = dim;
+            if (i+1 < num_chunks) {
+                line += std::count(p, e, '\n');
+            }
+            p = e;
+        }
+
+        auto run = [] (TextChunk& chunk) {
+            try {
+                parse_chunk(chunk);
+            }
+            catch (...) {
+                chunk.error = std::current_exception();
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < num_chunks; ++i) {
+            threads.emplace_back(run, std::ref(chunks[i]));
+        }
+        run(chunks[0]);
+        for (auto&& t : threads) {
+            t.join();
+        }
+
+        size_t num_rows = 0, dense_cols = 0, sparse_cols = 0;
+        for (auto&& chunk : chunks) {
+            if (chunk.error) {
+                std::rethrow_exception(chunk.error);
+            }
+            if (dense_cols && chunk.dense_cols &&
+                    chunk.dense_cols != dense_cols) {
+                fail(chunk.first_line, "column count differs from the "
+                     "previous rows");
+            }
+            if (chunk.dense_cols) {
+                dense_cols = chunk.dense_cols;
+            }
+            sparse_cols = std::max(sparse_cols, chunk.sparse_cols);
+            num_rows += chunk.rows.size();
+        }
+        size_t num_cols = dim;
+        if (!num_cols) {
+            if (dense_cols && sparse_cols > dense_cols) {
+                throw parse_error("sparse column index exceeds the number "
+                                  "of columns of the dense rows");
+            }
+            num_cols = dense_cols ? dense_cols : sparse_cols;
+        }
+
+        System s(num_rows, num_cols);
+        if (provenance) {
+            provenance->clear();
+        }
+        for (auto&& chunk : chunks) {
+            for (auto&& v : chunk.rows) {
+                if (v.size() < num_cols) {
+                    Vector w(num_cols);
+                    w.values[std::slice(0, v.size(), 1)] = v.values;
+                    v = std::move(w);
+                }
+                s.add_inequality(std::move(v));
+            }
+            if (provenance) {
+                *provenance += chunk.provenance;
+            }
+        }
+        return s;
+    }
+
+    System read_system(std::istream& in, std::string* provenance)
+    {
+        // (read in large blocks, pipes can not be mapped)
+        std::string buf;
+        const size_t block = 1 << 20;
+        for (size_t n = block; n == block; ) {
+            size_t size = buf.size();
+            buf.resize(size + block);
+            in.read(&buf[size], block);
+            n = in.gcount();
+            buf.resize(size + n);
+        }
+        memory::record(memory::IO, buf.capacity());
+        System s = is_binary(buf.data(), buf.size())
+            ? decode(buf.data(), buf.size(), provenance)
+            : parse_text(buf.data(), buf.size(), provenance);
+        memory::record(memory::IO, 0);
+        return s;
+    }
+
+    // Regular files are mapped rather than read, so the rows can be parsed
+    // or decoded directly from the page cache:
+    System read_system(const std::string& filename, std::string* provenance)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+            close(fd);
+            std::ifstream in(filename, std::ios::binary);
+            return read_system(in, provenance);
+        }
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Cannot map file: " + filename);
+        }
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+        try {
+            const char* p = static_cast<const char*>(data);
+            System s = is_binary(p, st.st_size)
+                ? decode(p, st.st_size, provenance)
+                : parse_text(p, st.st_size, provenance);
+            munmap(data, st.st_size);
+            return s;
+        }
+        catch (...) {
+            munmap(data, st.st_size);
+            throw;
+        }
+    }
+
+    Matrix read_matrix(std::istream& in)
+    {
+        System s = read_system(in);
+        s.split_equalities();
+        return std::move(s.ineqs);
+    }
+
+    Matrix read_matrix(const std::string& filename)
+    {
+        System s = read_system(filename);
+        s.split_equalities();
+        return std::move(s.ineqs);
+    }
+
+    void write_binary(std::ostream& out, const System& s,
+                      const std::string& provenance,
+                      double max_sparse_fill)
+    {
+        size_t num_rows = s.ineqs.size() + s.eqs.size();
+        auto for_each_row = [&] (std::function<void(const Vector&)> f) {
+            for (auto&& v : s.ineqs) f(v);
+            for (auto&& v : s.eqs) f(v);
+        };
+
+        uint64_t nnz = 0;
+        for_each_row([&] (const Vector& v) {
+            for (Value x : v.values) {
+                nnz += x != 0;
+            }
+        });
+        bool sparse = num_rows * s.num_cols > 0 &&
+            nnz <= max_sparse_fill * num_rows * s.num_cols;
+
+        BinaryHeader h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, magic, sizeof(magic));
+        h.version = version;
+        h.value_size = sizeof(Value);
+        h.flags = sparse ? BinaryHeader::SPARSE : 0;
+        h.provenance = provenance.size();
+        h.num_cols = s.num_cols;
+        h.num_ineqs = s.ineqs.size();
+        h.num_eqs = s.eqs.size();
+        h.data = align(sizeof(h) + provenance.size(), data_align);
+
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(provenance.data(), provenance.size());
+        out << std::string(h.data - sizeof(h) - provenance.size(), '\0');
+
+        auto put = [&] (const void* p, size_t n) {
+            out.write(static_cast<const char*>(p), n);
+        };
+        if (sparse) {
+            uint64_t offset = 0;
+            put(&offset, 8);
+            for_each_row([&] (const Vector& v) {
+                for (Value x : v.values) {
+                    offset += x != 0;
+                }
+                put(&offset, 8);
+            });
+            for_each_row([&] (const Vector& v) {
+                for (uint32_t col = 0; col < v.size(); ++col) {
+                    if (v.get(col)) {
+                        put(&col, 4);
+                    }
+                }
+            });
+            size_t pos = (num_rows+1) * 8 + nnz * 4;
+            out << std::string(align(pos, 8) - pos, '\0');
+            for_each_row([&] (const Vector& v) {
+                for (Value x : v.values) {
+                    if (x) {
+                        put(&x, sizeof(x));
+                    }
+                }
+            });
+        }
+        else {
+            for_each_row([&] (const Vector& v) {
+                if (v.size()) {
+                    put(&v.values[0], v.size() * sizeof(Value));
+                }
+            });
+        }
+    }
+
+    // class TextWriter
+
+    static const size_t buffer_size = 1 << 20;
+
+    Format output_format(const util::Args& args)
+    {
+        if (args.has("binary"))
+            return BINARY;
+        if (args.has("sparse"))
+            return SPARSE;
+        if (args.has("compact"))
+            return COMPACT;
+        return TEXT;
+    }
+
+    TextWriter::TextWriter(std::ostream& o, Format f, bool b)
+        : out(o)
+        , format(f)
+        , background(b)
+        , buf(buffer_size)
+        , pending(buffer_size)
+    {
+    }
+
+    TextWriter::~TextWriter()
+    {
+        try {
+            flush();
+        }
+        catch (...) {
+        }
+    }
+
+    void TextWriter::reserve(size_t n)
+    {
+        if (len + n > buffer_size) {
+            swap_out();
+        }
+    }
+
+    // Hand the buffer over to the output (on the writer thread, after the
+    // previous buffer is done):
+    void TextWriter::swap_out()
+    {
+        if (writer.joinable()) {
+            writer.join();
+        }
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+        if (len == 0) {
+            return;
+        }
+        buf.swap(pending);
+        pending_len = len;
+        len = 0;
+        if (!background) {
+            out.write(pending.data(), pending_len);
+            return;
+        }
+        writer = std::thread([this] {
+            try {
+                out.write(pending.data(), pending_len);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        });
+    }
+
+    char* TextWriter::put(char* p, long long v)
+    {
+        // digits in reverse order:
+        char digits[24];
+        int n = 0;
+        unsigned long long x = v < 0 ? -(unsigned long long)(v) : v;
+        do {
+            digits[n++] = '0' + x % 10;
+            x /= 10;
+        } while (x);
+        if (v < 0) {
+            digits[n++] = '-';
+        }
+        if (format == TEXT) {
+            for (int i = n; i < 3; ++i) {
+                *p++ = ' ';
+            }
+        }
+        while (n) {
+            *p++ = digits[--n];
+        }
+        return p;
+    }
+
+    void TextWriter::write(const std::string& text)
+    {
+        reserve(text.size());
+        if (text.size() > buffer_size) {
+            swap_out();
+            out.write(text.data(), text.size());
+            return;
+        }
+        std::memcpy(&buf[len], text.data(), text.size());
+        len += text.size();
+    }
+
+    void TextWriter::write_dim(size_t num_cols)
+    {
+        if (format == SPARSE) {
+            write("# dim: " + std::to_string(num_cols) + "\n");
+        }
+    }
+
+    // (a value takes at most 22 characters including the separator, an
+    // index:value pair at most 44)
+    void TextWriter::write(const ValArray& row)
+    {
+        if (format == SPARSE) {
+            // (the nonzeros are formatted directly from the dense row, in
+            // batches of columns small enough that the reserved space for
+            // the worst case does not flush a mostly empty buffer)
+            size_t i = 0, k = 0;
+            do {
+                size_t batch = std::min(row.size() - i, size_t(256));
+                reserve(batch * 44 + 1);
+                char* p = &buf[len];
+                for (size_t end = i + batch; i < end; ++i) {
+                    if (!row[i]) {
+                        continue;
+                    }
+                    if (k++) {
+                        *p++ = ' ';
+                    }
+                    p = put(p, i);
+                    *p++ = ':';
+                    p = put(p, row[i]);
+                }
+                len = p - &buf[0];
+            } while (i < row.size());
+            if (!k) {
+                write("0:0\n");
+                return;
+            }
+            buf[len++] = '\n';
+            return;
+        }
+        bool compact = format == COMPACT;
+        size_t i = 0;
+        do {
+            size_t batch = std::min(row.size() - i, buffer_size / 22 - 1);
+            reserve(batch * 22 + 1);
+            char* p = &buf[len];
+            for (size_t end = i + batch; i < end; ++i) {
+                if (compact && i) {
+                    *p++ = ' ';
+                }
+                p = put(p, row[i]);
+                if (!compact) {
+                    *p++ = ' ';
+                }
+            }
+            len = p - &buf[0];
+        } while (i < row.size());
+        buf[len++] = '\n';
+    }
+
+    void TextWriter::write(const SparseVector& row)
+    {
+        if (format != SPARSE) {
+            write(row.dense().values);
+            return;
+        }
+        // (an empty line would be skipped, so zero rows are kept as "0:0")
+        if (row.index.empty()) {
+            write("0:0\n");
+            return;
+        }
+        size_t k = 0;
+        do {
+            size_t batch = std::min(row.nnz() - k, buffer_size / 44 - 1);
+            reserve(batch * 44 + 1);
+            char* p = &buf[len];
+            for (size_t end = k + batch; k < end; ++k) {
+                if (k) {
+                    *p++ = ' ';
+                }
+                p = put(p, row.index[k]);
+                *p++ = ':';
+                p = put(p, row.value[k]);
+            }
+            len = p - &buf[0];
+        } while (k < row.nnz());
+        buf[len++] = '\n';
+    }
+
+    void TextWriter::write(const System& s)
+    {
+        for (auto&& v : s.ineqs) {
+            write(v.values);
+        }
+        for (auto&& v : s.eqs) {
+            write(v.values);
+            write(ValArray(-v.values));
+        }
+    }
+
+    void TextWriter::flush()
+    {
+        swap_out();
+        swap_out();
+        out.flush();
+    }
+
+    void write_system(std::ostream& out, const System& s,
+                      const std::string& provenance, Format format)
+    {
+        if (format == BINARY) {
+            write_binary(out, s, provenance);
+            out.flush();
+            return;
+        }
+        TextWriter writer(out, format, true);
+        writer.write(provenance);
+        if (!provenance.empty() && provenance.back() != '\n') {
+            writer.write("\n");
+        }
+        writer.write_dim(s.num_cols);
+        writer.write(s);
+        writer.flush();
+    }
+
+}
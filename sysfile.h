@@ -0,0 +1,127 @@
+// Reading and writing systems in the text format or in a binary format.
+//
+// The text format has one row per line (coefficients separated by
+// whitespace, '#' starts a comment). Equalities are written as pairs of
+// opposite inequalities. In the sparse text form, rows list only the
+// nonzeros as "col:coef" pairs, after a "# dim: N" header line:
+//
+//      # dim: 8
+//      7:1 6:-1
+//      1:1 2:1 3:-1
+//
+// (without the header, the number of columns is the largest index + 1).
+//
+// The binary format (native byte order) starts with a BinaryHeader,
+// followed by the provenance text (the comment header of the text format)
+// and, at a 64 byte aligned offset, the row data: the inequalities
+// followed by the equalities, either
+//
+//  - dense:  num_rows * num_cols coefficients, or
+//  - sparse: num_rows+1 row offsets (uint64), then the column indices
+//            (uint32) and, 8 byte aligned, the values of the nonzeros.
+//
+// Coefficients are signed integers of value_size bytes, which need not
+// match the Value type of the build (they are range checked).
+//
+// All tools detect the format of their input automatically.
+
+#ifndef __SYSFILE_H__INCLUDED__
+#define __SYSFILE_H__INCLUDED__
+
+# include <cstdint>     // uint32_t, uint64_t
+# include <exception>   // exception_ptr
+# include <iostream>
+# include <string>
+# include <thread>
+# include <vector>
+
+# include "fm.h"
+# include "util.h"      // Args
+
+
+namespace fm
+{
+
+    struct BinaryHeader
+    {
+        char magic[8];              // "CFMESYS" + '\0'
+        uint32_t version;
+        uint32_t value_size;        // bytes per coefficient
+        uint32_t flags;
+        uint32_t provenance;        // length of the provenance text
+        uint64_t num_cols;
+        uint64_t num_ineqs;
+        uint64_t num_eqs;
+        uint64_t data;              // offset of the row data
+
+        enum { SPARSE = 1 };
+    };
+
+    // Read a system in either format. With the text format, equalities are
+    // only recovered when calling System::find_equalities. The comment
+    // lines (or the binary provenance) are stored in `provenance`. Throws
+    // parse_error (with the line number) on malformed text, e.g. rows with
+    // differing column counts.
+    System read_system(std::istream& in, std::string* provenance=nullptr);
+    System read_system(const std::string& filename,
+                       std::string* provenance=nullptr);
+
+    // same, returning all rows as inequalities
+    Matrix read_matrix(std::istream& in);
+    Matrix read_matrix(const std::string& filename);
+
+    // Write the system in binary form, sparse if at most the given fraction
+    // of the coefficients is nonzero.
+    void write_binary(std::ostream& out, const System& s,
+                      const std::string& provenance="",
+                      double max_sparse_fill=0.25);
+
+    enum Format { TEXT, COMPACT, SPARSE, BINARY };
+
+    // from the --binary, --compact and --sparse options
+    Format output_format(const util::Args& args);
+
+    // Buffered text output. Rows are formatted into a large buffer (in the
+    // same layout as operator<<, without padding in COMPACT mode or as
+    // col:coef pairs in SPARSE mode). With `background`, full buffers are
+    // written to the stream on a separate thread while the next buffer is
+    // formatted.
+    class TextWriter
+    {
+        std::ostream& out;
+        Format format;
+        bool background;
+        std::vector<char> buf, pending;
+        size_t len = 0, pending_len = 0;
+        std::thread writer;
+        std::exception_ptr error;
+
+        void reserve(size_t n);
+        char* put(char* p, long long x);
+        void swap_out();
+    public:
+        explicit TextWriter(std::ostream& out, Format format=TEXT,
+                            bool background=false);
+        ~TextWriter();
+
+        void write(const std::string& text);
+        // "# dim: N" header for the SPARSE mode
+        void write_dim(size_t num_cols);
+        void write(const ValArray& row);
+        void write(const SparseVector& row);
+        void write(const System& s);
+        // write out everything, rethrows errors of the background thread
+        void flush();
+    };
+
+    // Write the provenance (as comments) and the system. Text is written
+    // through a background TextWriter, which overlaps the I/O with the
+    // formatting of the next rows, but the call still returns only once
+    // everything is written: the caller's computation does not continue
+    // meanwhile (the system must stay unchanged while it is written).
+    void write_system(std::ostream& out, const System& s,
+                      const std::string& provenance, Format format=TEXT);
+
+}
+
+#endif  // include guard
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <fstream>
 #include "util.h"
+#include "memory.h"
 
 #include <stdlib.h>         // these are for terminal Input
 #include <termios.h>
@@ -34,6 +35,35 @@ string util::get_command_output(const string& command)
 }
 
 
+util::Args::Args(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            size_t eq = arg.find('=');
+            if (eq == string::npos)
+                opt[arg.substr(2)] = "";
+            else
+                opt[arg.substr(2, eq-2)] = arg.substr(eq+1);
+        }
+        else {
+            pos.push_back(arg);
+        }
+    }
+}
+
+bool util::Args::has(const string& name) const
+{
+    return opt.find(name) != opt.end();
+}
+
+string util::Args::get(const string& name, const string& def) const
+{
+    auto it = opt.find(name);
+    return it == opt.end() ? def : it->second;
+}
+
+
 string git::commit_info()
 {
     string info = git::commit;
@@ -125,8 +155,12 @@ std::vector<std::string> util::read_file(std::istream& in)
 {
     std::vector<string> lines;
     string line;
-    while (std::getline(in, line))
+    size_t bytes = 0;
+    while (std::getline(in, line)) {
+        bytes += sizeof(string) + line.capacity();
         lines.push_back(line);
+    }
+    memory::record(memory::IO, bytes);
     return lines;
 }
 
@@ -150,6 +184,7 @@ string util::AutogenNotice::str() const
     out << "# start date:   " << std::ctime(&start_time);
     out << "# git commit:   " << git::commit_info() << endl;
     out << "# running time: " << timer.format(3) << endl;
+    out << "# peak memory:  " << memory::summary(memory::peak()) << endl;
     string result = out.str();
     result.pop_back();
     return result;
@@ -3,6 +3,7 @@
 
 # include <ctime>       // time_t
 # include <iostream>
+# include <map>
 # include <sstream>
 # include <string>
 # include <utility>     // move
@@ -47,6 +48,21 @@ namespace util
         std::string str() const;
     };
 
+    // Command line arguments split into positional arguments and options
+    // of the form "--name" or "--name=value".
+    class Args
+    {
+    public:
+        std::vector<std::string> pos;
+        std::map<std::string, std::string> opt;
+
+        Args(int argc, char** argv);
+
+        bool has(const std::string& name) const;
+        std::string get(const std::string& name,
+                        const std::string& def="") const;
+    };
+
     std::string get_command_output(const std::string& command);
 
     std::string join(const std::vector<std::string>&, const std::string& sep);